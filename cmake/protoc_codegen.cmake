@@ -0,0 +1,75 @@
+# Runs protoc for a landlock_proto_library, see cmake/rules.cmake.
+#
+# Usage: cmake -DARGS=<file> -P protoc_codegen.cmake
+#
+# ARGS is written by landlock_proto_library and sets:
+# PROTOC: The protoc executable
+# PLUGIN: Optional protoc-gen-<name>=<path> for --plugin
+# LANGUAGES: The languages to generate, e.g. cpp;grpc
+# IMPORT_DIRS: The -I directories, the own protos' first
+# PROTOS: The .proto files to generate code for
+# INPUTS: Every file the generated code depends on: the protos, including
+#         those of DEPS, and the plugin
+# OUT_DIR: The directory to generate into
+# OUTPUTS: The generated files, relative to OUT_DIR
+# STAMP: A file to remember the hash of the last run in
+#
+# Code is only generated if the hash of the inputs, the arguments and the
+# protoc version changed since the last run. protoc writes into a staging
+# directory, and only outputs whose contents changed are copied to OUT_DIR, so
+# touching a .proto doesn't recompile everything that includes its headers.
+cmake_minimum_required(VERSION 3.21)
+
+include("${ARGS}")
+
+execute_process(
+  COMMAND "${PROTOC}" --version
+  OUTPUT_VARIABLE _version
+  COMMAND_ERROR_IS_FATAL ANY
+)
+set(_key "version ${_version}\n")
+foreach(_var IN ITEMS PLUGIN LANGUAGES IMPORT_DIRS PROTOS OUTPUTS)
+  string(APPEND _key "${_var} ${${_var}}\n")
+endforeach()
+foreach(_input IN LISTS INPUTS)
+  file(SHA256 "${_input}" _hash)
+  string(APPEND _key "input ${_input} ${_hash}\n")
+endforeach()
+string(SHA256 _key "${_key}")
+
+set(_complete TRUE)
+foreach(_output IN LISTS OUTPUTS)
+  if(NOT EXISTS "${OUT_DIR}/${_output}")
+    set(_complete FALSE)
+  endif()
+endforeach()
+if(_complete AND EXISTS "${STAMP}")
+  file(READ "${STAMP}" _last)
+  if(_last STREQUAL _key)
+    file(TOUCH "${STAMP}")
+    return()
+  endif()
+endif()
+
+set(_staging "${STAMP}.staging")
+file(REMOVE_RECURSE "${_staging}")
+file(MAKE_DIRECTORY "${_staging}")
+set(_args "")
+foreach(_dir IN LISTS IMPORT_DIRS)
+  list(APPEND _args "-I${_dir}")
+endforeach()
+if(PLUGIN)
+  list(APPEND _args "--plugin=${PLUGIN}")
+endif()
+foreach(_language IN LISTS LANGUAGES)
+  list(APPEND _args "--${_language}_out=${_staging}")
+endforeach()
+execute_process(
+  COMMAND "${PROTOC}" ${_args} ${PROTOS}
+  COMMAND_ERROR_IS_FATAL ANY
+)
+foreach(_output IN LISTS OUTPUTS)
+  file(COPY_FILE "${_staging}/${_output}" "${OUT_DIR}/${_output}" ONLY_IF_DIFFERENT)
+endforeach()
+file(REMOVE_RECURSE "${_staging}")
+file(WRITE "${STAMP}" "${_key}")
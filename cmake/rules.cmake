@@ -12,6 +12,535 @@ define_property(
   BRIEF_DOCS "A list of .proto files that were used to generate this target, can be used for strict sandboxing of protoc"
 )
 
+define_property(
+  TARGET
+  PROPERTY landlock_transitive_proto_files
+  BRIEF_DOCS "The .proto files of a proto library and of all proto libraries in its DEPS, what protoc may read"
+)
+
+define_property(
+  TARGET
+  PROPERTY landlock_deps
+  BRIEF_DOCS "The DEPS of a landlock_* rule"
+)
+
+define_property(
+  TARGET
+  PROPERTY landlock_transitive_headers
+  BRIEF_DOCS "The public headers of a target and all of its DEPS, only known once configuring is done"
+)
+
+define_property(
+  TARGET
+  PROPERTY landlock_pch_files
+  BRIEF_DOCS "The precompiled header of another target that a target reuses, which its sandbox must be able to read"
+)
+
+define_property(
+  TARGET
+  PROPERTY landlock_sandbox_policy
+  BRIEF_DOCS "The precompiled sandbox policy of a target, see tools/sandbox/policy.h"
+)
+
+option(LANDLOCK_SANDBOX "Compile landlock_cc_* targets in a sandbox that only allows declared headers" ON)
+set(LANDLOCK_SANDBOX_FORK_SERVER "" CACHE STRING
+  "Socket of a sandbox fork server to compile on, see tools/sandbox/fork_server.h")
+set(LANDLOCK_SANDBOX_CACHE_DIR "" CACHE PATH
+  "Directory of a local compile cache shared by sandboxed compiles, see tools/sandbox/cache.h")
+set(LANDLOCK_SANDBOX_REMOTE_CACHE "" CACHE STRING
+  "Address of a cache_server shared by sandboxed compiles, see src/service/remote_cache.proto")
+set(LANDLOCK_SANDBOX_REMOTE_CACHE_TOKEN "" CACHE FILEPATH
+  "File with the token of the LANDLOCK_SANDBOX_REMOTE_CACHE, see cache_server --token_file")
+set(LANDLOCK_SANDBOX_REMOTE_CACHE_CA "" CACHE FILEPATH
+  "PEM root certificates to talk TLS to the LANDLOCK_SANDBOX_REMOTE_CACHE with")
+set(LANDLOCK_SANDBOX_REMOTE_WRAPPER "" CACHE FILEPATH
+  "A prebuilt remote_process_wrapper, the wrapper built here can't talk to a LANDLOCK_SANDBOX_REMOTE_CACHE")
+set(LANDLOCK_SANDBOX_STATS "" CACHE FILEPATH
+  "File the sandboxed compiles append per-action timings and resource usage to, see tools/sandbox/stats.h")
+if(LANDLOCK_SANDBOX_STATS)
+  add_custom_target(sandbox_trace
+    COMMAND sandbox::trace_export "${LANDLOCK_SANDBOX_STATS}" "${CMAKE_BINARY_DIR}/sandbox_trace.json"
+    COMMENT "Writing ${CMAKE_BINARY_DIR}/sandbox_trace.json from ${LANDLOCK_SANDBOX_STATS}"
+    VERBATIM
+  )
+endif()
+option(LANDLOCK_SANDBOX_NETWORK
+  "Let sandboxed compiles and tests use the network, which also keeps compiles out of LANDLOCK_SANDBOX_REMOTE_CACHE" OFF)
+option(LANDLOCK_SANDBOX_PRIVATE_TMP
+  "Give every sandboxed compile and test a new TMPDIR of its own instead of the shared /tmp" OFF)
+option(LANDLOCK_SANDBOX_CAPTURE_OUTPUT
+  "Buffer the output of sandboxed compiles and only show it for failed ones" OFF)
+set(LANDLOCK_SANDBOX_OUTPUT_LOG "" CACHE FILEPATH
+  "File the LANDLOCK_SANDBOX_CAPTURE_OUTPUT compiles append the output of failures to zstd compressed, only its first lines are shown")
+option(LANDLOCK_SANDBOX_AUDIT
+  "Compile landlock_cc_* targets without denying anything, and record the headers each compile read, see tools/sandbox/audit.h" OFF)
+option(LANDLOCK_SANDBOX_AUDITED_DEPS
+  "Limit the sandbox of every audited target to the DEPS its compiles used, see landlock_audit" OFF)
+set(_landlock_audit_file "${CMAKE_BINARY_DIR}/landlock_audit.cmake")
+if(LANDLOCK_SANDBOX_AUDIT)
+  add_custom_target(landlock_audit
+    COMMAND sandbox::audit_report "${CMAKE_BINARY_DIR}/landlock_audit_targets.txt" "${_landlock_audit_file}"
+    COMMENT "Writing ${_landlock_audit_file} from the --audit manifests"
+    VERBATIM
+  )
+endif()
+if((LANDLOCK_SANDBOX_AUDIT OR LANDLOCK_SANDBOX_AUDITED_DEPS) AND EXISTS "${_landlock_audit_file}")
+  include("${_landlock_audit_file}")
+  set_property(DIRECTORY "${CMAKE_SOURCE_DIR}" APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${_landlock_audit_file}")
+endif()
+if(LANDLOCK_SANDBOX_REMOTE_CACHE AND NOT LANDLOCK_SANDBOX_REMOTE_WRAPPER)
+  message(FATAL_ERROR "LANDLOCK_SANDBOX_REMOTE_CACHE requires LANDLOCK_SANDBOX_REMOTE_WRAPPER")
+endif()
+option(LANDLOCK_UNITY_BUILD
+  "Compile the SRCS of landlock_cc_library and landlock_cc_test targets in batches of LANDLOCK_UNITY_BATCH_SIZE, unless they set UNITY" OFF)
+set(LANDLOCK_UNITY_BATCH_SIZE 8 CACHE STRING
+  "Sources per translation unit of unity builds, see LANDLOCK_UNITY_BUILD")
+set(LANDLOCK_LTO "OFF" CACHE STRING
+  "Link time optimization of landlock_cc_* targets, so calls into other libraries can be inlined: OFF, FULL or THIN (Clang only)")
+set_property(CACHE LANDLOCK_LTO PROPERTY STRINGS OFF FULL THIN)
+if(NOT LANDLOCK_LTO MATCHES "^(OFF|FULL|THIN)$")
+  message(FATAL_ERROR "LANDLOCK_LTO must be OFF, FULL or THIN, not ${LANDLOCK_LTO}")
+endif()
+if(LANDLOCK_LTO STREQUAL "THIN" AND NOT CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+  message(FATAL_ERROR "LANDLOCK_LTO=THIN requires Clang, use FULL with ${CMAKE_CXX_COMPILER_ID}")
+endif()
+if(NOT LANDLOCK_LTO STREQUAL "OFF")
+  include(CheckIPOSupported)
+  check_ipo_supported(RESULT _landlock_lto_supported OUTPUT _landlock_lto_output LANGUAGES CXX)
+  if(NOT _landlock_lto_supported)
+    message(FATAL_ERROR "LANDLOCK_LTO=${LANDLOCK_LTO} is not supported: ${_landlock_lto_output}")
+  endif()
+endif()
+
+# _landlock_regex_escape()
+#
+# Internal helper to escape a path for use in a regular expression.
+function(_landlock_regex_escape OUT VALUE)
+  string(REGEX REPLACE "([][+.*()^$?|\\\\])" "\\\\\\1" _escaped "${VALUE}")
+  set(${OUT} "${_escaped}" PARENT_SCOPE)
+endfunction()
+
+# _landlock_sandbox_policy()
+#
+# Internal helper to compile the sandbox policy for a target, see
+# tools/sandbox/policy.h. The policy is written to ${NAME}.policy in the
+# current binary directory, and recorded in the landlock_sandbox_policy
+# property.
+#
+# Parameters:
+# READONLY: List of files and directories that may be read, can contain
+#           generator expressions
+# READWRITE: List of files and directories that may be written
+#
+# The rules are written with file(GENERATE), which leaves the file untouched
+# if they didn't change, so the policy is only recompiled if the rules did.
+function(_landlock_sandbox_policy NAME)
+  cmake_parse_arguments(_POLICY "" "" "READONLY;READWRITE" ${ARGN})
+  set(_rules "${CMAKE_CURRENT_BINARY_DIR}/${NAME}.policy.txt")
+  set(_policy "${CMAKE_CURRENT_BINARY_DIR}/${NAME}.policy")
+  set(_content "")
+  foreach(_kind IN ITEMS READONLY READWRITE)
+    if(_kind STREQUAL "READONLY")
+      set(_flag "ro_paths")
+    else()
+      set(_flag "rw_paths")
+    endif()
+    set(_paths "$<REMOVE_DUPLICATES:${_POLICY_${_kind}}>")
+    string(APPEND _content "$<$<BOOL:${_paths}>:${_flag} $<JOIN:${_paths},\n${_flag} >\n>")
+  endforeach()
+  file(GENERATE OUTPUT "${_rules}" CONTENT "${_content}")
+  add_custom_command(
+    OUTPUT "${_policy}"
+    COMMAND $<TARGET_FILE:sandbox::policy_compiler> "${_rules}" "${_policy}"
+    DEPENDS "${_rules}" sandbox_policy_compiler
+    COMMENT "Compiling sandbox policy for ${NAME}"
+    VERBATIM
+  )
+  add_custom_target(${NAME}_sandbox_policy DEPENDS "${_policy}")
+  add_dependencies(${NAME} ${NAME}_sandbox_policy)
+  set_target_properties(${NAME} PROPERTIES landlock_sandbox_policy "${_policy}")
+endfunction()
+
+# _landlock_transitive_headers()
+#
+# Internal helper to record a target's DEPS, so that the public headers of
+# the target and everything it depends on can be collected into
+# landlock_transitive_headers.
+#
+# DEPS may be defined after the target that uses them, so the headers are
+# only collected once all targets are known, see _landlock_finalize.
+function(_landlock_transitive_headers NAME)
+  cmake_parse_arguments(_TRANSITIVE "" "" "DEPS" ${ARGN})
+  set_target_properties(${NAME} PROPERTIES landlock_deps "${_TRANSITIVE_DEPS}")
+  set_property(GLOBAL APPEND PROPERTY landlock_targets ${NAME})
+endfunction()
+
+# _landlock_header_closure()
+#
+# Internal helper that sets OUT to the public headers of TARGET and of
+# everything it depends on. Each closure is computed once per configure and
+# kept in the target's _landlock_header_closure property, so a target shared
+# by many others is walked once instead of once for every path to it.
+function(_landlock_header_closure OUT TARGET)
+  get_target_property(_aliased ${TARGET} ALIASED_TARGET)
+  if(_aliased)
+    set(TARGET ${_aliased})
+  endif()
+  get_property(_known TARGET ${TARGET} PROPERTY _landlock_header_closure SET)
+  if(_known)
+    get_target_property(_closure ${TARGET} _landlock_header_closure)
+    set(${OUT} "${_closure}" PARENT_SCOPE)
+    return()
+  endif()
+  get_target_property(_closure ${TARGET} landlock_public_headers)
+  get_target_property(_deps ${TARGET} landlock_deps)
+  if(_closure STREQUAL "_closure-NOTFOUND")
+    set(_closure "")
+    if(NOT _deps)
+      # Not a landlock target (e.g. GTest::gtest), nothing to remember.
+      set(${OUT} "" PARENT_SCOPE)
+      return()
+    endif()
+  endif()
+  # Recorded first, so a cycle ends here.
+  set_property(TARGET ${TARGET} PROPERTY _landlock_header_closure "${_closure}")
+  if(_deps)
+    _landlock_collect_headers(_closure ${_deps})
+    list(REMOVE_DUPLICATES _closure)
+  endif()
+  set_property(TARGET ${TARGET} PROPERTY _landlock_header_closure "${_closure}")
+  set(${OUT} "${_closure}" PARENT_SCOPE)
+endfunction()
+
+# _landlock_collect_headers()
+#
+# Internal helper that appends the public headers of every landlock target
+# in DEPS, and of everything they depend on, to OUT.
+function(_landlock_collect_headers OUT)
+  set(_headers ${${OUT}})
+  foreach(_dep IN LISTS ARGN)
+    if(NOT TARGET ${_dep})
+      continue()
+    endif()
+    _landlock_header_closure(_dep_headers ${_dep})
+    list(APPEND _headers ${_dep_headers})
+  endforeach()
+  set(${OUT} "${_headers}" PARENT_SCOPE)
+endfunction()
+
+# _landlock_audit_record()
+#
+# Internal helper that appends the records sandbox_audit_report needs about
+# a target to OUT: its object directory, its public headers and its DEPS
+# with aliases resolved, see tools/sandbox/audit_report.cc.
+function(_landlock_audit_record OUT NAME)
+  set(_records "${${OUT}}")
+  get_target_property(_type ${NAME} TYPE)
+  get_target_property(_binary_dir ${NAME} BINARY_DIR)
+  set(_object_dir "${_binary_dir}/CMakeFiles/${NAME}.dir")
+  if(_type STREQUAL "INTERFACE_LIBRARY")
+    set(_object_dir "-")
+  endif()
+  set(_display "${NAME}")
+  if(NAME MATCHES "^landlock_(.*)$")
+    if(TARGET my::${CMAKE_MATCH_1})
+      set(_display "my::${CMAKE_MATCH_1}")
+    endif()
+  endif()
+  string(APPEND _records "target ${NAME} ${_display} ${_object_dir}\n")
+  get_target_property(_headers ${NAME} landlock_public_headers)
+  if(NOT _headers STREQUAL "_headers-NOTFOUND")
+    foreach(_header IN LISTS _headers)
+      string(APPEND _records "header ${NAME} ${_header}\n")
+    endforeach()
+  endif()
+  get_target_property(_deps ${NAME} landlock_deps)
+  if(NOT _deps)
+    set(_deps "")
+  endif()
+  foreach(_dep IN LISTS _deps)
+    set(_resolved "-")
+    if(TARGET ${_dep})
+      get_target_property(_resolved ${_dep} ALIASED_TARGET)
+      if(NOT _resolved)
+        set(_resolved "${_dep}")
+      endif()
+    endif()
+    string(APPEND _records "dep ${NAME} ${_dep} ${_resolved}\n")
+  endforeach()
+  set(${OUT} "${_records}" PARENT_SCOPE)
+endfunction()
+
+# _landlock_finalize()
+#
+# Internal helper that runs at the end of the configure step, once every
+# target is defined, to fill in landlock_transitive_headers.
+#
+# With LANDLOCK_SANDBOX_AUDIT it also writes the targets for the
+# landlock_audit report, and warns about the DEPS a previous report found
+# unused or missing. With LANDLOCK_SANDBOX_AUDITED_DEPS the headers of a
+# target come from the DEPS the report found used instead of all DEPS.
+function(_landlock_finalize)
+  get_property(_targets GLOBAL PROPERTY landlock_targets)
+  set(_audit "")
+  set(_audited "")
+  foreach(_target IN LISTS _targets)
+    get_target_property(_headers ${_target} landlock_public_headers)
+    if(_headers STREQUAL "_headers-NOTFOUND")
+      set(_headers "")
+    endif()
+    get_target_property(_deps ${_target} landlock_deps)
+    if(LANDLOCK_SANDBOX_AUDITED_DEPS AND DEFINED LANDLOCK_AUDIT_DEPS_${_target})
+      set(_deps "${LANDLOCK_AUDIT_DEPS_${_target}}")
+    endif()
+    _landlock_collect_headers(_headers ${_deps})
+    list(REMOVE_DUPLICATES _headers)
+    set_target_properties(${_target} PROPERTIES landlock_transitive_headers "${_headers}")
+
+    if(NOT LANDLOCK_SANDBOX_AUDIT)
+      continue()
+    endif()
+    _landlock_audit_record(_audit ${_target})
+    list(APPEND _audited ${_target})
+    if(LANDLOCK_AUDIT_UNUSED_${_target})
+      list(JOIN LANDLOCK_AUDIT_UNUSED_${_target} ", " _unused)
+      message(WARNING "${_target}: no compile used the DEPS ${_unused}, see ${_landlock_audit_file}")
+    endif()
+    if(LANDLOCK_AUDIT_UNDECLARED_${_target})
+      list(JOIN LANDLOCK_AUDIT_UNDECLARED_${_target} ", " _undeclared)
+      message(WARNING "${_target}: compiles read headers of ${_undeclared}, which are not in its DEPS")
+    endif()
+  endforeach()
+  if(LANDLOCK_SANDBOX_AUDIT)
+    # Libraries that are not landlock targets can still own headers, e.g.
+    # sandbox::lib.
+    foreach(_target IN LISTS _targets)
+      get_target_property(_deps ${_target} landlock_deps)
+      foreach(_dep IN LISTS _deps)
+        if(NOT TARGET ${_dep})
+          continue()
+        endif()
+        get_target_property(_resolved ${_dep} ALIASED_TARGET)
+        if(NOT _resolved)
+          set(_resolved "${_dep}")
+        endif()
+        get_target_property(_dep_headers ${_resolved} landlock_public_headers)
+        if(_resolved IN_LIST _audited OR _dep_headers STREQUAL "_dep_headers-NOTFOUND")
+          continue()
+        endif()
+        _landlock_audit_record(_audit ${_resolved})
+        list(APPEND _audited ${_resolved})
+      endforeach()
+    endforeach()
+    file(GENERATE OUTPUT "${CMAKE_BINARY_DIR}/landlock_audit_targets.txt" CONTENT "${_audit}")
+  endif()
+endfunction()
+cmake_language(DEFER DIRECTORY ${CMAKE_SOURCE_DIR} CALL _landlock_finalize)
+
+# _landlock_lto()
+#
+# Internal helper to compile and link a target for LANDLOCK_LTO.
+#
+# The objects hold the compiler's IR and code is only generated at the link,
+# for the whole binary, so calls across libraries can be inlined. ThinLTO
+# keeps a cache in the build directory, so relinking after a change only
+# regenerates the code of the modules it affects.
+function(_landlock_lto NAME)
+  if(LANDLOCK_LTO STREQUAL "OFF")
+    return()
+  endif()
+  # Also makes static libraries use the archiver of the compiler, which
+  # indexes the IR.
+  set_target_properties(${NAME} PROPERTIES INTERPROCEDURAL_OPTIMIZATION ON)
+  if(NOT CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+    return()
+  endif()
+  # CMake picks ThinLTO for Clang, the later flag wins.
+  if(LANDLOCK_LTO STREQUAL "THIN")
+    target_compile_options(${NAME} PRIVATE -flto=thin)
+    target_link_options(${NAME} PRIVATE
+      -flto=thin
+      "LINKER:--thinlto-cache-dir=${CMAKE_BINARY_DIR}/thinlto_cache"
+    )
+  else()
+    target_compile_options(${NAME} PRIVATE -flto=full)
+    target_link_options(${NAME} PRIVATE -flto=full)
+  endif()
+endfunction()
+
+# _landlock_unity_build()
+#
+# Internal helper to turn CMake's unity build on or off for a target.
+#
+# CMake writes the unity sources to the target's object directory, and they
+# include the target's own SRCS by absolute path. The sandbox of a compile
+# already allows both, so the policy of a target is the same for unity and
+# regular builds.
+#
+# Parameters:
+# UNITY: ON or OFF, defaults to LANDLOCK_UNITY_BUILD
+# BATCH_SIZE: Sources per translation unit, defaults to
+#             LANDLOCK_UNITY_BATCH_SIZE
+function(_landlock_unity_build NAME)
+  cmake_parse_arguments(_UNITY "" "UNITY;BATCH_SIZE" "" ${ARGN})
+  if("${_UNITY_UNITY}" STREQUAL "")
+    set(_UNITY_UNITY ${LANDLOCK_UNITY_BUILD})
+  endif()
+  if("${_UNITY_BATCH_SIZE}" STREQUAL "")
+    set(_UNITY_BATCH_SIZE ${LANDLOCK_UNITY_BATCH_SIZE})
+  endif()
+  if(_UNITY_UNITY)
+    set_target_properties(${NAME} PROPERTIES
+      UNITY_BUILD ON
+      UNITY_BUILD_BATCH_SIZE ${_UNITY_BATCH_SIZE}
+    )
+  else()
+    set_target_properties(${NAME} PROPERTIES UNITY_BUILD OFF)
+  endif()
+endfunction()
+
+# _landlock_precompile_headers()
+#
+# Internal helper to precompile the PCH headers of a target.
+#
+# Targets of the same type with the same headers, COPTS, DEFINES and DEPS
+# compile with the same flags, so all of them reuse the PCH of the first one
+# (REUSE_FROM). The PCH is written to the object directory of that target,
+# and recorded in landlock_pch_files of the others, so their sandboxes may
+# read it.
+#
+# Parameters:
+# HEADERS: List of headers, `<fmt/format.h>` or paths
+# FLAGS: Everything else that has to match for sharing the PCH
+function(_landlock_precompile_headers NAME)
+  cmake_parse_arguments(_PCH "" "" "HEADERS;FLAGS" ${ARGN})
+  if(NOT _PCH_HEADERS)
+    return()
+  endif()
+  set(_headers "")
+  foreach(_header IN LISTS _PCH_HEADERS)
+    if(NOT _header MATCHES "^<.*>$")
+      cmake_path(ABSOLUTE_PATH _header BASE_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR})
+    endif()
+    list(APPEND _headers "${_header}")
+  endforeach()
+  get_target_property(_type ${NAME} TYPE)
+  string(SHA256 _key "${_type};${_headers};${_PCH_FLAGS}")
+  get_property(_provider GLOBAL PROPERTY _landlock_pch_${_key})
+  if(NOT _provider)
+    target_precompile_headers(${NAME} PRIVATE ${_headers})
+    set_property(GLOBAL PROPERTY _landlock_pch_${_key} ${NAME})
+    return()
+  endif()
+  target_precompile_headers(${NAME} REUSE_FROM ${_provider})
+
+  get_target_property(_binary_dir ${_provider} BINARY_DIR)
+  set(_pch_dir "${_binary_dir}/CMakeFiles/${_provider}.dir")
+  get_property(_multi_config GLOBAL PROPERTY GENERATOR_IS_MULTI_CONFIG)
+  if(_multi_config)
+    string(APPEND _pch_dir "/$<CONFIG>")
+  endif()
+  # GCC writes .gch files and Clang .pch files, the missing ones are skipped.
+  set(_files "")
+  foreach(_pch IN ITEMS cmake_pch.hxx cmake_pch.h)
+    list(APPEND _files "${_pch_dir}/${_pch}" "${_pch_dir}/${_pch}.gch" "${_pch_dir}/${_pch}.pch")
+  endforeach()
+  set_target_properties(${NAME} PROPERTIES landlock_pch_files "${_files}")
+endfunction()
+
+# _landlock_sandbox_compile()
+#
+# Internal helper to compile a target through the sandbox process wrapper, so
+# the compiler can only read the target's own sources, the public headers of
+# its transitive DEPS and the include directories of third party packages.
+# Including anything else, e.g. a header of a library that isn't in DEPS,
+# fails the compile.
+#
+# Parameters:
+# SRCS: List of source files (and private headers) of the target
+function(_landlock_sandbox_compile NAME)
+  cmake_parse_arguments(_SANDBOX "" "" "SRCS" ${ARGN})
+  if(NOT LANDLOCK_SANDBOX)
+    return()
+  endif()
+  set(_srcs "")
+  foreach(_src IN LISTS _SANDBOX_SRCS)
+    cmake_path(ABSOLUTE_PATH _src BASE_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR})
+    list(APPEND _srcs "${_src}")
+  endforeach()
+
+  # Include directories outside of this project belong to third party
+  # packages, which are readable as a whole. Our own include directories
+  # (e.g. src/) are not, only the declared headers below them are.
+  _landlock_regex_escape(_source_re "${PROJECT_SOURCE_DIR}/")
+  _landlock_regex_escape(_binary_re "${PROJECT_BINARY_DIR}/")
+  set(_includes "$<TARGET_PROPERTY:${NAME},INCLUDE_DIRECTORIES>")
+  set(_external "$<FILTER:$<FILTER:${_includes},EXCLUDE,^${_source_re}>,EXCLUDE,^${_binary_re}>")
+  if(VCPKG_INSTALLED_DIR)
+    _landlock_regex_escape(_vcpkg_re "${VCPKG_INSTALLED_DIR}/")
+    list(APPEND _external "$<FILTER:${_includes},INCLUDE,^${_vcpkg_re}>")
+  endif()
+
+  _landlock_sandbox_policy(${NAME}
+    READONLY
+      ${_srcs}
+      "$<TARGET_PROPERTY:${NAME},landlock_transitive_headers>"
+      "$<TARGET_PROPERTY:${NAME},landlock_pch_files>"
+      ${_external}
+    READWRITE
+      "${CMAKE_CURRENT_BINARY_DIR}/CMakeFiles/${NAME}.dir"
+  )
+  get_target_property(_policy ${NAME} landlock_sandbox_policy)
+
+  if(LANDLOCK_SANDBOX_REMOTE_CACHE)
+    set(_launcher "${LANDLOCK_SANDBOX_REMOTE_WRAPPER}"
+      "--remote_cache=${LANDLOCK_SANDBOX_REMOTE_CACHE}")
+    if(LANDLOCK_SANDBOX_REMOTE_CACHE_TOKEN)
+      list(APPEND _launcher
+        "--remote_cache_token=${LANDLOCK_SANDBOX_REMOTE_CACHE_TOKEN}")
+    endif()
+    if(LANDLOCK_SANDBOX_REMOTE_CACHE_CA)
+      list(APPEND _launcher
+        "--remote_cache_ca=${LANDLOCK_SANDBOX_REMOTE_CACHE_CA}")
+    endif()
+  else()
+    set(_launcher "${SANDBOX_PROCESS_WRAPPER}")
+  endif()
+  if(LANDLOCK_SANDBOX_FORK_SERVER)
+    list(APPEND _launcher "--connect=${LANDLOCK_SANDBOX_FORK_SERVER}")
+  endif()
+  if(LANDLOCK_SANDBOX_CACHE_DIR)
+    list(APPEND _launcher "--cache_dir=${LANDLOCK_SANDBOX_CACHE_DIR}")
+  endif()
+  if(LANDLOCK_SANDBOX_STATS)
+    list(APPEND _launcher "--stats=${LANDLOCK_SANDBOX_STATS}" "--label=${NAME}")
+  endif()
+  if(NOT LANDLOCK_SANDBOX_NETWORK)
+    list(APPEND _launcher "--deny_network")
+  endif()
+  if(LANDLOCK_SANDBOX_PRIVATE_TMP)
+    list(APPEND _launcher "--private_tmp")
+  endif()
+  if(LANDLOCK_SANDBOX_CAPTURE_OUTPUT)
+    list(APPEND _launcher "--capture_output")
+    if(LANDLOCK_SANDBOX_OUTPUT_LOG)
+      list(APPEND _launcher "--output_log=${LANDLOCK_SANDBOX_OUTPUT_LOG}")
+    endif()
+    if(NOT LANDLOCK_SANDBOX_STATS)
+      list(APPEND _launcher "--label=${NAME}")
+    endif()
+  endif()
+  if(LANDLOCK_SANDBOX_AUDIT)
+    list(APPEND _launcher "--audit")
+  endif()
+  list(APPEND _launcher "--policy=${_policy}" "--")
+  set_target_properties(${NAME} PROPERTIES
+    C_COMPILER_LAUNCHER "${_launcher}"
+    CXX_COMPILER_LAUNCHER "${_launcher}"
+  )
+  add_dependencies(${NAME} ${SANDBOX_PROCESS_WRAPPER_TARGET})
+endfunction()
+
 # landlock_cc_library()
 #
 # CMake function to imitate a starlark-like cc_library rule.
@@ -24,6 +553,11 @@ define_property(
 # COPTS: List of private compile options
 # DEFINES: List of public defines
 # LINKOPTS: List of link options
+# UNITY: ON or OFF, if SRCS are compiled in batches, defaults to
+#        LANDLOCK_UNITY_BUILD
+# UNITY_BATCH_SIZE: Sources per batch, defaults to LANDLOCK_UNITY_BATCH_SIZE
+# PCH: List of headers to precompile, e.g. <fmt/format.h>, shared with other
+#      targets that use the same headers and flags
 #
 # Note:
 # By default, landlock_cc_library will always create a library named my_${NAME},
@@ -58,8 +592,8 @@ define_property(
 function(landlock_cc_library)
   cmake_parse_arguments(LANDLOCK_CC_LIB
     "" # options
-    "NAME" # single value
-    "HDRS;SRCS;COPTS;DEFINES;LINKOPTS;DEPS" # multi value 
+    "NAME;UNITY;UNITY_BATCH_SIZE" # single value
+    "HDRS;SRCS;COPTS;DEFINES;LINKOPTS;DEPS;PCH" # multi value 
     ${ARGN})
 
   set(_NAME "landlock_${LANDLOCK_CC_LIB_NAME}")
@@ -76,21 +610,29 @@ function(landlock_cc_library)
   if(NOT LANDLOCK_CC_LIB_IS_INTERFACE)
     add_library(${_NAME} "")
     target_sources(${_NAME} PRIVATE ${LANDLOCK_CC_LIB_SRCS} ${LANDLOCK_CC_LIB_HDRS})
-    # TODO: Determine how to limit header visibility
-    # There are really 3 approaches:
-    # - Symlink headers so that includes are limited (bazel does this), downside being some tooling is confused by symlinks
-    # - Force include directory pattern . this basically puts the burden on the dev to isolate headers
-    # - Use something like landlock LSM to sandbox headers via a wrapper and CXX_COMPILER_LAUNCHER
+    # Header visibility is limited by compiling in a landlock sandbox, see
+    # _landlock_sandbox_compile
     target_compile_options(${_NAME}
       PRIVATE ${LANDLOCK_CC_LIB_COPTS})
     target_link_libraries(${_NAME}
       PUBLIC ${LANDLOCK_CC_LIB_DEPS}
       PRIVATE ${LANDLOCK_CC_LIB_LINKOPTS})
     target_compile_definitions(${_NAME} PUBLIC ${LANDLOCK_CC_LIB_DEFINES})
+    _landlock_unity_build(${_NAME}
+      UNITY ${LANDLOCK_CC_LIB_UNITY}
+      BATCH_SIZE ${LANDLOCK_CC_LIB_UNITY_BATCH_SIZE}
+    )
+    _landlock_lto(${_NAME})
+    _landlock_precompile_headers(${_NAME}
+      HEADERS ${LANDLOCK_CC_LIB_PCH}
+      FLAGS
+        ${LANDLOCK_CC_LIB_COPTS}
+        ${LANDLOCK_CC_LIB_DEFINES}
+        ${LANDLOCK_CC_LIB_DEPS}
+    )
   else()
     # Generating header-only library
     add_library(${_NAME} INTERFACE)
-    # TODO: Limit header visibility - see options above
     target_link_libraries(${_NAME}
       INTERFACE
       ${LANDLOCK_CC_LIB_DEPS}
@@ -99,11 +641,18 @@ function(landlock_cc_library)
     target_compile_definitions(${_NAME} INTERFACE ${LANDLOCK_CC_LIB_DEFINES})
   endif()
 
-  set(LANDLOCK_CC_HDRS "${LANDLOCK_CC_HDRS}")
-  # Use absolute paths
+  # Use absolute paths, generated headers already are
+  set(LANDLOCK_CC_HDRS "")
+  foreach(_hdr IN LISTS LANDLOCK_CC_LIB_HDRS)
+    cmake_path(ABSOLUTE_PATH _hdr BASE_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR})
+    list(APPEND LANDLOCK_CC_HDRS "${_hdr}")
+  endforeach()
   list(TRANSFORM LANDLOCK_CC_SRCS PREPEND ${CMAKE_CURRENT_SOURCE_DIR}/)
-  # TODO(rockwood): add dependencies
-  set_target_properties(${_NAME} PROPERTIES landlock_public_headers "${LANDLOCK_CC_LIB_HDRS}")
+  set_target_properties(${_NAME} PROPERTIES landlock_public_headers "${LANDLOCK_CC_HDRS}")
+  _landlock_transitive_headers(${_NAME} DEPS ${LANDLOCK_CC_LIB_DEPS})
+  if(NOT LANDLOCK_CC_LIB_IS_INTERFACE)
+    _landlock_sandbox_compile(${_NAME} SRCS ${LANDLOCK_CC_LIB_SRCS})
+  endif()
   # main symbol exported
   add_library(my::${LANDLOCK_CC_LIB_NAME} ALIAS ${_NAME})
 endfunction()
@@ -124,6 +673,16 @@ find_package(gRPC CONFIG REQUIRED)
 # LINKOPTS: List of link options
 # GRPC: If the gRPC protoc plugin should be used.
 #
+# Note:
+# The directory of every proto is an import path, for the protos of DEPS too,
+# so `foo.proto` imports `bar.proto` of my::bar as "bar.proto". Proto
+# libraries in DEPS must be defined before the libraries that import them.
+#
+# With LANDLOCK_SANDBOX, protoc runs in a sandbox that can only read the
+# protos of the target and its DEPS. Code is only generated when the protos,
+# protoc or the plugin changed, and only changed files are rewritten, see
+# cmake/protoc_codegen.cmake.
+#
 # landlock_proto_library(
 #   NAME
 #     foo
@@ -149,29 +708,93 @@ function(landlock_proto_library)
 
   set(_NAME "landlock_protoc_generated_sources_${LANDLOCK_PROTO_LIB_NAME}")
 
-  # TODO: Add import dirs for dependencies, right now this assumes all protos
-  # are in a single directory
-  protobuf_generate(
-    PROTOS ${LANDLOCK_PROTO_LIB_SRCS}
-    LANGUAGE cpp
-    GENERATE_EXTENSIONS .pb.h .pb.cc
-    OUT_VAR _generated_pb
-  )
+  set(_protos "")
+  set(_import_dirs "")
+  set(_outputs "")
+  set(_languages cpp)
+  set(_extensions .pb.h .pb.cc)
+  set(_plugin "")
   set(_extra_deps "")
   if (LANDLOCK_PROTO_LIB_GRPC)
-    protobuf_generate(
-      PROTOS ${LANDLOCK_PROTO_LIB_SRCS}
-      LANGUAGE grpc
-      GENERATE_EXTENSIONS .grpc.pb.h .grpc.pb.cc
-      PLUGIN "protoc-gen-grpc=\$<TARGET_FILE:gRPC::grpc_cpp_plugin>"
-      OUT_VAR _generated_grpc_pb
-    )
-    set(_generated_pb ${_generated_pb} ${_generated_grpc_pb})
+    list(APPEND _languages grpc)
+    list(APPEND _extensions .grpc.pb.h .grpc.pb.cc)
+    set(_plugin "protoc-gen-grpc=$<TARGET_FILE:gRPC::grpc_cpp_plugin>")
     set(_extra_deps gRPC::grpc gRPC::grpc++ gRPC::grpc++_reflection)
   endif()
+  foreach(_proto IN LISTS LANDLOCK_PROTO_LIB_SRCS)
+    cmake_path(ABSOLUTE_PATH _proto BASE_DIRECTORY ${CMAKE_CURRENT_SOURCE_DIR})
+    cmake_path(GET _proto PARENT_PATH _dir)
+    cmake_path(GET _proto STEM LAST_ONLY _stem)
+    list(APPEND _protos "${_proto}")
+    list(APPEND _import_dirs "${_dir}")
+    foreach(_extension IN LISTS _extensions)
+      list(APPEND _outputs "${_stem}${_extension}")
+    endforeach()
+  endforeach()
+
+  set(_transitive_protos ${_protos})
+  foreach(_dep IN LISTS LANDLOCK_PROTO_LIB_DEPS)
+    if(NOT TARGET ${_dep})
+      message(FATAL_ERROR "${LANDLOCK_PROTO_LIB_NAME}: ${_dep} is not defined yet, proto libraries must be defined before the libraries that import them")
+    endif()
+    get_target_property(_dep_protos ${_dep} landlock_transitive_proto_files)
+    if(_dep_protos)
+      list(APPEND _transitive_protos ${_dep_protos})
+    endif()
+  endforeach()
+  list(REMOVE_DUPLICATES _transitive_protos)
+  foreach(_proto IN LISTS _transitive_protos)
+    cmake_path(GET _proto PARENT_PATH _dir)
+    list(APPEND _import_dirs "${_dir}")
+  endforeach()
+  # The well known types, e.g. google/protobuf/timestamp.proto.
+  set(_protobuf_includes "$<TARGET_PROPERTY:protobuf::libprotobuf,INTERFACE_INCLUDE_DIRECTORIES>")
+  list(APPEND _import_dirs "${_protobuf_includes}")
+  list(REMOVE_DUPLICATES _import_dirs)
+
+  set(_generated_pb "${_outputs}")
+  list(TRANSFORM _generated_pb PREPEND "${CMAKE_CURRENT_BINARY_DIR}/")
+  set(_inputs ${_transitive_protos})
+  if(LANDLOCK_PROTO_LIB_GRPC)
+    list(APPEND _inputs "$<TARGET_FILE:gRPC::grpc_cpp_plugin>")
+  endif()
+  set(_args "${CMAKE_CURRENT_BINARY_DIR}/${_NAME}.args.cmake")
+  set(_stamp "${CMAKE_CURRENT_BINARY_DIR}/${_NAME}.stamp")
+  set(_script "${CMAKE_CURRENT_FUNCTION_LIST_DIR}/protoc_codegen.cmake")
+  file(GENERATE OUTPUT "${_args}" CONTENT
+"set(PROTOC \"$<TARGET_FILE:protobuf::protoc>\")
+set(PLUGIN \"${_plugin}\")
+set(LANGUAGES \"${_languages}\")
+set(IMPORT_DIRS \"${_import_dirs}\")
+set(PROTOS \"${_protos}\")
+set(INPUTS \"${_inputs}\")
+set(OUT_DIR \"${CMAKE_CURRENT_BINARY_DIR}\")
+set(OUTPUTS \"${_outputs}\")
+set(STAMP \"${_stamp}\")
+")
+  # The generated files are byproducts, which Ninja checks again after the
+  # command ran, so what includes an unchanged header isn't recompiled.
+  add_custom_command(
+    OUTPUT "${_stamp}"
+    BYPRODUCTS ${_generated_pb}
+    COMMAND ${CMAKE_COMMAND} "-DARGS=${_args}" -P "${_script}"
+    DEPENDS
+      ${_inputs}
+      protobuf::protoc
+      "${_args}"
+      "${_script}"
+    COMMENT "Generating code for ${LANDLOCK_PROTO_LIB_NAME}"
+    VERBATIM
+  )
+  add_custom_target(${_NAME} DEPENDS "${_stamp}")
+
+  # Generated code repeats file local names, so it can't share a unity
+  # source.
   set_source_files_properties(
     ${_generated_pb}
-    PROPERTIES SKIP_LINTING ON
+    PROPERTIES
+      SKIP_LINTING ON
+      SKIP_UNITY_BUILD_INCLUSION ON
   )
   set(GENERATED_HDRS "${_generated_pb}")
   list(FILTER GENERATED_HDRS INCLUDE REGEX ".*\\.(h|inc)")
@@ -189,14 +812,56 @@ function(landlock_proto_library)
     DEFINES ${LANDLOCK_PROTO_LIB_DEFINES}
     LINKOPTS ${LANDLOCK_PROTO_LIB_LINKOPTS}
   )
-  set(LANDLOCK_PROTOS "${LANDLOCK_PROTO_LIB_SRCS}")
-  # Use absolute paths
-  list(TRANSFORM LANDLOCK_PROTOS PREPEND ${CMAKE_CURRENT_SOURCE_DIR}/)
-  # TODO(rockwood): add dependencies
-  set_target_properties(my::${LANDLOCK_PROTO_LIB_NAME} PROPERTIES landlock_proto_files "${LANDLOCK_PROTOS}")
+  add_dependencies(landlock_${LANDLOCK_PROTO_LIB_NAME} ${_NAME})
+
+  if(LANDLOCK_SANDBOX)
+    # protoc (through cmake -P) can read the protos it imports, the well known
+    # types and itself, and write the generated code.
+    _landlock_sandbox_policy(${_NAME}
+      READONLY
+        ${_inputs}
+        "$<TARGET_FILE:protobuf::protoc>"
+        "${_protobuf_includes}"
+        "${CMAKE_COMMAND}"
+        "${CMAKE_ROOT}"
+        "${_script}"
+        "${_args}"
+      READWRITE
+        "${CMAKE_CURRENT_BINARY_DIR}"
+    )
+    get_target_property(_policy ${_NAME} landlock_sandbox_policy)
+    set(_launcher "${SANDBOX_PROCESS_WRAPPER}")
+    if(NOT LANDLOCK_SANDBOX_NETWORK)
+      string(APPEND _launcher " --deny_network")
+    endif()
+    if(LANDLOCK_SANDBOX_PRIVATE_TMP)
+      string(APPEND _launcher " --private_tmp")
+    endif()
+    if(LANDLOCK_SANDBOX_CAPTURE_OUTPUT)
+      string(APPEND _launcher " --capture_output")
+      if(LANDLOCK_SANDBOX_OUTPUT_LOG)
+        string(APPEND _launcher " --output_log=${LANDLOCK_SANDBOX_OUTPUT_LOG}")
+      endif()
+    endif()
+    if(LANDLOCK_SANDBOX_STATS)
+      string(APPEND _launcher " --stats=${LANDLOCK_SANDBOX_STATS} --label=${_NAME}")
+    endif()
+    set_property(TARGET ${_NAME} PROPERTY RULE_LAUNCH_CUSTOM "${_launcher} --policy=${_policy} --")
+    add_dependencies(${_NAME} ${SANDBOX_PROCESS_WRAPPER_TARGET})
+  elseif(LANDLOCK_SANDBOX_STATS)
+    # Without the sandbox protoc's time should still show up in the stats.
+    set_property(TARGET ${_NAME} PROPERTY RULE_LAUNCH_CUSTOM
+      "${SANDBOX_PROCESS_WRAPPER} --stats=${LANDLOCK_SANDBOX_STATS} --label=${_NAME} --ro_paths=/ --rw_paths=${CMAKE_CURRENT_BINARY_DIR} --")
+    add_dependencies(${_NAME} ${SANDBOX_PROCESS_WRAPPER_TARGET})
+  endif()
+  set_target_properties(landlock_${LANDLOCK_PROTO_LIB_NAME} PROPERTIES
+    landlock_proto_files "${_protos}"
+    landlock_transitive_proto_files "${_transitive_protos}"
+  )
 endfunction()
 
 find_package(GTest REQUIRED)
+include(GoogleTest)
 
 # landlock_cc_test()
 #
@@ -209,11 +874,27 @@ find_package(GTest REQUIRED)
 # COPTS: List of private compile options
 # DEFINES: List of public defines
 # LINKOPTS: List of link options
+# UNITY: ON or OFF, if SRCS are compiled in batches, defaults to
+#        LANDLOCK_UNITY_BUILD
+# UNITY_BATCH_SIZE: Sources per batch, defaults to LANDLOCK_UNITY_BATCH_SIZE
+# PCH: List of headers to precompile, e.g. <fmt/format.h>, shared with other
+#      targets that use the same headers and flags
+# SHARD_COUNT: Split the test cases into this many ctest entries, see below
 #
 # Note:
 # By default, landlock_cc_test will always create a binary named my_${NAME}.
 # This will also add it to ctest list as landlock_${NAME}.
 #
+# The test cases are listed when ctest runs, and only listed again once the
+# binary was rebuilt. With LANDLOCK_SANDBOX every case runs with a private
+# TMPDIR (--private_tmp), the only place besides /dev it may write. With
+# SHARD_COUNT they aren't listed at all: the binary is added as
+# landlock_${NAME}.shard_<i> entries, which run a part of the cases each
+# (GTEST_SHARD_INDEX and GTEST_TOTAL_SHARDS). Every shard gets a scratch
+# directory of its own as working directory and TMPDIR, and with
+# LANDLOCK_SANDBOX it may only write there, so shards can run in parallel
+# (ctest -j).
+#
 # Usage:
 # landlock_cc_library(
 #   NAME
@@ -237,8 +918,8 @@ find_package(GTest REQUIRED)
 function(landlock_cc_test)
   cmake_parse_arguments(LANDLOCK_CC_TEST
     ""
-    "NAME"
-    "SRCS;COPTS;DEFINES;LINKOPTS;DEPS"
+    "NAME;UNITY;UNITY_BATCH_SIZE;SHARD_COUNT"
+    "SRCS;COPTS;DEFINES;LINKOPTS;DEPS;PCH"
     ${ARGN}
   )
 
@@ -255,7 +936,67 @@ function(landlock_cc_test)
   target_link_libraries(${_NAME}
     PUBLIC ${LANDLOCK_CC_TEST_DEPS}
     PRIVATE ${LANDLOCK_CC_TEST_LINKOPTS})
-  gtest_discover_tests(${_NAME})
+  _landlock_unity_build(${_NAME}
+    UNITY ${LANDLOCK_CC_TEST_UNITY}
+    BATCH_SIZE ${LANDLOCK_CC_TEST_UNITY_BATCH_SIZE}
+  )
+  _landlock_lto(${_NAME})
+  _landlock_precompile_headers(${_NAME}
+    HEADERS ${LANDLOCK_CC_TEST_PCH}
+    FLAGS
+      ${LANDLOCK_CC_TEST_COPTS}
+      ${LANDLOCK_CC_TEST_DEFINES}
+      ${LANDLOCK_CC_TEST_DEPS}
+  )
+  _landlock_transitive_headers(${_NAME} DEPS ${LANDLOCK_CC_TEST_DEPS})
+  _landlock_sandbox_compile(${_NAME} SRCS ${LANDLOCK_CC_TEST_SRCS})
+  # Tests may read the whole file system, but only write to a private TMPDIR
+  # and the devices, and can't use the network. Both ctest and the test
+  # discovery run the binary through its emulator; shards have a scratch
+  # directory of their own instead, see below.
+  if(LANDLOCK_SANDBOX AND NOT LANDLOCK_CC_TEST_SHARD_COUNT)
+    set(_emulator ${SANDBOX_PROCESS_WRAPPER} --ro_paths=/ --private_tmp
+      --rw_paths=/dev)
+    if(NOT LANDLOCK_SANDBOX_NETWORK)
+      list(APPEND _emulator --deny_network)
+    endif()
+    set_target_properties(${_NAME} PROPERTIES CROSSCOMPILING_EMULATOR
+      "${_emulator};--")
+    add_dependencies(${_NAME} ${SANDBOX_PROCESS_WRAPPER_TARGET})
+  endif()
+  if(NOT LANDLOCK_CC_TEST_SHARD_COUNT)
+    gtest_discover_tests(${_NAME} DISCOVERY_MODE PRE_TEST)
+    return()
+  endif()
+
+  set(_wrapper "")
+  if(LANDLOCK_SANDBOX)
+    # Shards only write to their scratch directory and the devices, their
+    # TMPDIR is a private one below the scratch directory.
+    set(_wrapper ${SANDBOX_PROCESS_WRAPPER} --ro_paths=/ --private_tmp)
+    if(NOT LANDLOCK_SANDBOX_NETWORK)
+      list(APPEND _wrapper --deny_network)
+    endif()
+    add_dependencies(${_NAME} ${SANDBOX_PROCESS_WRAPPER_TARGET})
+  endif()
+  math(EXPR _last "${LANDLOCK_CC_TEST_SHARD_COUNT} - 1")
+  foreach(_shard RANGE ${_last})
+    set(_test "${_NAME}.shard_${_shard}")
+    set(_scratch "${CMAKE_CURRENT_BINARY_DIR}/${_test}.scratch")
+    set(_command "")
+    if(_wrapper)
+      set(_command ${_wrapper} --rw_paths=${_scratch}:/dev --)
+    endif()
+    add_test(NAME ${_test}
+      COMMAND ${CMAKE_COMMAND} -DSCRATCH=${_scratch}
+        -P "${CMAKE_CURRENT_FUNCTION_LIST_DIR}/test_shard.cmake" --
+        ${_command} $<TARGET_FILE:${_NAME}>
+    )
+    set_tests_properties(${_test} PROPERTIES
+      ENVIRONMENT
+        "GTEST_SHARD_INDEX=${_shard};GTEST_TOTAL_SHARDS=${LANDLOCK_CC_TEST_SHARD_COUNT}"
+    )
+  endforeach()
 endfunction()
 
 # landlock_cc_binary()
@@ -270,6 +1011,8 @@ endfunction()
 # DEFINES: List of public defines
 # LINKOPTS: List of link options
 # DISABLE_INSTALL: Disable installation of the binary
+# PCH: List of headers to precompile, e.g. <fmt/format.h>, shared with other
+#      targets that use the same headers and flags
 # DESTINATION: Subdirectory to install the binary (in `ninja install`)
 #
 # Note:
@@ -299,7 +1042,7 @@ function(landlock_cc_binary)
   cmake_parse_arguments(LANDLOCK_CC_BINARY
     "DISABLE_INSTALL"
     "NAME"
-    "SRCS;COPTS;DEFINES;LINKOPTS;DEPS;DESTINATION"
+    "SRCS;COPTS;DEFINES;LINKOPTS;DEPS;DESTINATION;PCH"
     ${ARGN}
   )
 
@@ -320,6 +1063,20 @@ function(landlock_cc_binary)
     PUBLIC ${LANDLOCK_CC_BINARY_DEPS}
     PRIVATE ${LANDLOCK_CC_BINARY_LINKOPTS}
   )
+  _landlock_lto(${LANDLOCK_CC_BINARY_NAME})
+  _landlock_precompile_headers(${LANDLOCK_CC_BINARY_NAME}
+    HEADERS ${LANDLOCK_CC_BINARY_PCH}
+    FLAGS
+      ${LANDLOCK_CC_BINARY_COPTS}
+      ${LANDLOCK_CC_BINARY_DEFINES}
+      ${LANDLOCK_CC_BINARY_DEPS}
+  )
+  _landlock_transitive_headers(${LANDLOCK_CC_BINARY_NAME}
+    DEPS ${LANDLOCK_CC_BINARY_DEPS}
+  )
+  _landlock_sandbox_compile(${LANDLOCK_CC_BINARY_NAME}
+    SRCS ${LANDLOCK_CC_BINARY_SRCS}
+  )
   if(NOT LANDLOCK_CC_BINARY_DISABLE_INSTALL)
     install(
       TARGETS ${LANDLOCK_CC_BINARY_NAME}
@@ -327,3 +1084,114 @@ function(landlock_cc_binary)
     )
   endif()
 endfunction()
+
+find_package(benchmark CONFIG REQUIRED)
+
+set(LANDLOCK_BENCHMARK_OUTPUT_DIR "${CMAKE_BINARY_DIR}/benchmarks" CACHE PATH
+  "Directory the landlock_benchmarks target writes the JSON results of every landlock_cc_benchmark to")
+if(NOT TARGET landlock_benchmarks)
+  add_custom_target(landlock_benchmarks)
+endif()
+
+# landlock_cc_benchmark()
+#
+# CMake function to build a Google Benchmark binary, like a landlock_cc_test
+# but run on demand instead of by ctest.
+#
+# Parameters:
+# NAME: name of target (see Note)
+# SRCS: List of source files for the binary
+# DEPS: List of other libraries to be linked in to the binary targets
+# COPTS: List of private compile options
+# DEFINES: List of public defines
+# LINKOPTS: List of link options
+# ARGS: List of extra flags for the runs, e.g. --benchmark_repetitions=5
+# PCH: List of headers to precompile, e.g. <fmt/format.h>, shared with other
+#      targets that use the same headers and flags
+#
+# Note:
+# By default, landlock_cc_benchmark will always create a binary named
+# landlock_${NAME}, linked with benchmark::benchmark_main unless SRCS define
+# their own main. Building landlock_${NAME}_run runs it and writes the
+# results to ${LANDLOCK_BENCHMARK_OUTPUT_DIR}/${NAME}.json, and the
+# landlock_benchmarks target runs every benchmark. The JSON context records
+# the build type, BUILD_SHARED_LIBS and LANDLOCK_LTO, so the results of
+# different presets (e.g. release and release-static) or releases can be
+# told apart and compared. Like tests, the runs have the whole file system
+# readable but not the network, and with LANDLOCK_SANDBOX may only write
+# their results.
+#
+# Usage:
+# landlock_cc_benchmark(
+#   NAME
+#     awesome_benchmark
+#   SRCS
+#     "awesome_benchmark.cc"
+#   DEPS
+#     my::awesome
+# )
+function(landlock_cc_benchmark)
+  cmake_parse_arguments(LANDLOCK_CC_BENCHMARK
+    ""
+    "NAME"
+    "SRCS;COPTS;DEFINES;LINKOPTS;DEPS;ARGS;PCH"
+    ${ARGN}
+  )
+
+  set(_NAME "landlock_${LANDLOCK_CC_BENCHMARK_NAME}")
+  set(_deps ${LANDLOCK_CC_BENCHMARK_DEPS} benchmark::benchmark
+    benchmark::benchmark_main)
+
+  add_executable(${_NAME} "")
+  target_sources(${_NAME} PRIVATE ${LANDLOCK_CC_BENCHMARK_SRCS})
+
+  target_compile_definitions(${_NAME}
+    PUBLIC ${LANDLOCK_CC_BENCHMARK_DEFINES})
+  target_compile_options(${_NAME}
+    PRIVATE ${LANDLOCK_CC_BENCHMARK_COPTS})
+
+  target_link_libraries(${_NAME}
+    PUBLIC ${_deps}
+    PRIVATE ${LANDLOCK_CC_BENCHMARK_LINKOPTS})
+  _landlock_lto(${_NAME})
+  _landlock_precompile_headers(${_NAME}
+    HEADERS ${LANDLOCK_CC_BENCHMARK_PCH}
+    FLAGS
+      ${LANDLOCK_CC_BENCHMARK_COPTS}
+      ${LANDLOCK_CC_BENCHMARK_DEFINES}
+      ${_deps}
+  )
+  _landlock_transitive_headers(${_NAME} DEPS ${_deps})
+  _landlock_sandbox_compile(${_NAME} SRCS ${LANDLOCK_CC_BENCHMARK_SRCS})
+
+  set(_output "${LANDLOCK_BENCHMARK_OUTPUT_DIR}/${LANDLOCK_CC_BENCHMARK_NAME}.json")
+  set(_shared OFF)
+  if(BUILD_SHARED_LIBS)
+    set(_shared ON)
+  endif()
+  set(_command "")
+  if(LANDLOCK_SANDBOX)
+    set(_command ${SANDBOX_PROCESS_WRAPPER} --ro_paths=/
+      --rw_paths=${LANDLOCK_BENCHMARK_OUTPUT_DIR}:/dev)
+    if(NOT LANDLOCK_SANDBOX_NETWORK)
+      list(APPEND _command --deny_network)
+    endif()
+    list(APPEND _command --)
+    add_dependencies(${_NAME} ${SANDBOX_PROCESS_WRAPPER_TARGET})
+  endif()
+  add_custom_target(${_NAME}_run
+    COMMAND ${CMAKE_COMMAND} -E make_directory "${LANDLOCK_BENCHMARK_OUTPUT_DIR}"
+    COMMAND ${_command} $<TARGET_FILE:${_NAME}>
+      "--benchmark_out=${_output}"
+      --benchmark_out_format=json
+      "--benchmark_context=build_type=${CMAKE_BUILD_TYPE}"
+      "--benchmark_context=shared_libs=${_shared}"
+      "--benchmark_context=lto=${LANDLOCK_LTO}"
+      ${LANDLOCK_CC_BENCHMARK_ARGS}
+    DEPENDS ${_NAME}
+    COMMENT "Running ${_NAME}, writing ${_output}"
+    USES_TERMINAL
+    VERBATIM
+  )
+  add_dependencies(landlock_benchmarks ${_NAME}_run)
+endfunction()
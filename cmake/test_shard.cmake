@@ -0,0 +1,39 @@
+# Runs one shard of a landlock_cc_test, see cmake/rules.cmake.
+#
+# Usage: cmake -DSCRATCH=<dir> -P test_shard.cmake -- <command> <args>...
+#
+# SCRATCH: A directory private to the shard. It's emptied before the command
+#          runs, is its working directory and TMPDIR, and is removed again if
+#          the command succeeded.
+#
+# The shard itself is picked by GTEST_SHARD_INDEX and GTEST_TOTAL_SHARDS,
+# which ctest sets in the environment of the test.
+cmake_minimum_required(VERSION 3.21)
+
+set(_command "")
+set(_found FALSE)
+math(EXPR _last "${CMAKE_ARGC} - 1")
+foreach(_i RANGE ${_last})
+  if(_found)
+    list(APPEND _command "${CMAKE_ARGV${_i}}")
+  elseif(CMAKE_ARGV${_i} STREQUAL "--")
+    set(_found TRUE)
+  endif()
+endforeach()
+if(NOT SCRATCH OR NOT _command)
+  message(FATAL_ERROR "usage: cmake -DSCRATCH=<dir> -P test_shard.cmake -- <command>")
+endif()
+
+file(REMOVE_RECURSE "${SCRATCH}")
+file(MAKE_DIRECTORY "${SCRATCH}")
+set(ENV{TMPDIR} "${SCRATCH}")
+set(ENV{TEST_TMPDIR} "${SCRATCH}")
+execute_process(
+  COMMAND ${_command}
+  WORKING_DIRECTORY "${SCRATCH}"
+  RESULT_VARIABLE _result
+)
+if(NOT _result EQUAL 0)
+  message(FATAL_ERROR "shard failed (${_result}), its files are kept in ${SCRATCH}")
+endif()
+file(REMOVE_RECURSE "${SCRATCH}")
@@ -0,0 +1,344 @@
+#include "bin/batch.h"
+
+#include <algorithm>
+#include <array>
+#include <barrier>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "lib/add.h"
+#include "lib/mul.h"
+#include "lib/slow_mul.h"
+
+namespace myproject {
+namespace {
+
+// The input handed to the threads at a time. Large enough that waking them
+// up is noise, small enough that reading stdin doesn't need much memory.
+constexpr size_t kBlockSize = 16 << 20;
+
+// Blocks aren't split into chunks smaller than this.
+constexpr size_t kMinChunkSize = 64 << 10;
+
+enum Operation { kAdd, kMultiply, kSlowMultiply, kOperations };
+
+constexpr std::array<std::string_view, kOperations> kOperationNames = {
+    "add", "multiply", "slow_multiply"};
+
+std::string_view TrimSpaces(std::string_view s) {
+  auto begin = s.find_first_not_of(" \t\r");
+  if (begin == std::string_view::npos) {
+    return {};
+  }
+  return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+}
+
+// Parses the next space separated int of `record`.
+bool ParseOperand(std::string_view *record, int *value) {
+  *record = TrimSpaces(*record);
+  auto [end, ec] =
+      std::from_chars(record->data(), record->data() + record->size(), *value);
+  if (ec != std::errc() ||
+      (end != record->data() + record->size() && *end != ' ' &&
+       *end != '\t')) {
+    return false;
+  }
+  record->remove_prefix(end - record->data());
+  return true;
+}
+
+void WriteAll(int fd, std::string_view data) {
+  while (!data.empty()) {
+    ssize_t n = write(fd, data.data(), data.size());
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(),
+                              "failed to write results");
+    }
+    data.remove_prefix(n);
+  }
+}
+
+// A part of a block, evaluated by one thread. The vectors and the output
+// keep their capacity, so only the first blocks allocate.
+class Chunk {
+public:
+  // Evaluates the records of `input` into Output(). Exceptions are kept for
+  // Rethrow.
+  void Run(std::string_view input) {
+    try {
+      Parse(input);
+      Evaluate();
+      Format();
+    } catch (...) {
+      error_ = std::current_exception();
+    }
+  }
+
+  // Rethrows what the last Run failed with, if anything.
+  void Rethrow() {
+    if (error_) {
+      std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+  }
+
+  std::string_view Output() const { return {output_.data(), output_.size()}; }
+
+private:
+  // The records of one operation, and where their results go.
+  struct Records {
+    std::vector<int> a;
+    std::vector<int> b;
+    std::vector<int> out;
+    std::vector<uint32_t> lines;
+  };
+
+  void Parse(std::string_view input) {
+    results_.clear();
+    for (auto &records : records_) {
+      records.a.clear();
+      records.b.clear();
+      records.lines.clear();
+    }
+    while (!input.empty()) {
+      auto newline = input.find('\n');
+      std::string_view line = input.substr(0, newline);
+      input.remove_prefix(newline == std::string_view::npos ? input.size()
+                                                            : newline + 1);
+      std::string_view record = TrimSpaces(line);
+      if (record.empty()) {
+        continue;
+      }
+      std::string_view name = record.substr(0, record.find_first_of(" \t"));
+      auto op = std::find(kOperationNames.begin(), kOperationNames.end(), name);
+      record.remove_prefix(name.size());
+      int a;
+      int b;
+      if (op == kOperationNames.end() || !ParseOperand(&record, &a) ||
+          !ParseOperand(&record, &b) || !TrimSpaces(record).empty()) {
+        throw std::runtime_error(fmt::format("invalid record: {}", line));
+      }
+      auto &records = records_[op - kOperationNames.begin()];
+      records.a.push_back(a);
+      records.b.push_back(b);
+      records.lines.push_back(results_.size());
+      results_.push_back(0);
+    }
+  }
+
+  void Evaluate() {
+    for (int op = 0; op < kOperations; ++op) {
+      auto &records = records_[op];
+      records.out.resize(records.a.size());
+      switch (op) {
+      case kAdd:
+        add_n(records.a, records.b, records.out);
+        break;
+      case kMultiply:
+        multiply_n(records.a, records.b, records.out);
+        break;
+      case kSlowMultiply:
+        for (size_t i = 0; i < records.out.size(); ++i) {
+          records.out[i] = slow_multiply(records.a[i], records.b[i]);
+        }
+        break;
+      }
+      for (size_t i = 0; i < records.out.size(); ++i) {
+        results_[records.lines[i]] = records.out[i];
+      }
+    }
+  }
+
+  void Format() {
+    output_.clear();
+    for (int result : results_) {
+      fmt::format_int formatted(result);
+      output_.append(formatted.data(), formatted.data() + formatted.size());
+      output_.push_back('\n');
+    }
+  }
+
+  std::array<Records, kOperations> records_;
+  std::vector<int> results_;
+  fmt::memory_buffer output_;
+  std::exception_ptr error_;
+};
+
+// Threads that run `work(i)` with their index `i` for every Run, kept for
+// all blocks.
+class ThreadPool {
+public:
+  ThreadPool(int threads, std::function<void(int)> work)
+      : work_(std::move(work)), start_(threads + 1), done_(threads + 1) {
+    for (int i = 0; i < threads; ++i) {
+      threads_.emplace_back([this, i] {
+        while (true) {
+          start_.arrive_and_wait();
+          if (stop_) {
+            return;
+          }
+          work_(i);
+          done_.arrive_and_wait();
+        }
+      });
+    }
+  }
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool() {
+    stop_ = true;
+    start_.arrive_and_wait();
+  }
+
+  // Returns once every thread ran `work` once.
+  void Run() {
+    start_.arrive_and_wait();
+    done_.arrive_and_wait();
+  }
+
+private:
+  std::function<void(int)> work_;
+  std::barrier<> start_;
+  std::barrier<> done_;
+  // Only written while the threads wait on start_.
+  bool stop_ = false;
+  // Last, so the threads are joined before the barriers are destroyed.
+  std::vector<std::jthread> threads_;
+};
+
+// Splits blocks into chunks and evaluates them on the pool.
+class Evaluator {
+public:
+  Evaluator(int threads, int out_fd)
+      : out_fd_(out_fd), chunks_(threads), inputs_(threads),
+        pool_(threads, [this](int i) { chunks_[i].Run(inputs_[i]); }) {}
+
+  // Evaluates the records of `block`, which ends at the end of a line, and
+  // writes their results.
+  void Run(std::string_view block) {
+    size_t count = std::clamp<size_t>(block.size() / kMinChunkSize, 1,
+                                      chunks_.size());
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+      if (i >= count) {
+        inputs_[i] = {};
+        continue;
+      }
+      size_t end = i + 1 == count ? block.size() : block.size() / (count - i);
+      if (end < block.size()) {
+        end = block.find('\n', end);
+        end = end == std::string_view::npos ? block.size() : end + 1;
+      }
+      inputs_[i] = block.substr(0, end);
+      block.remove_prefix(end);
+    }
+    pool_.Run();
+    for (auto &chunk : chunks_) {
+      chunk.Rethrow();
+    }
+    for (auto &chunk : chunks_) {
+      WriteAll(out_fd_, chunk.Output());
+    }
+  }
+
+private:
+  int out_fd_;
+  std::vector<Chunk> chunks_;
+  std::vector<std::string_view> inputs_;
+  // Last, so the threads are gone before the chunks are.
+  ThreadPool pool_;
+};
+
+// Evaluates a mapped regular file in blocks of about kBlockSize.
+void RunMapped(int fd, size_t size, Evaluator *evaluator) {
+  if (size == 0) {
+    return;
+  }
+  void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    throw std::system_error(errno, std::generic_category(),
+                            "failed to map input");
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+  std::string_view input(static_cast<const char *>(data), size);
+  try {
+    while (!input.empty()) {
+      size_t end = input.size();
+      if (end > kBlockSize) {
+        end = input.find('\n', kBlockSize);
+        end = end == std::string_view::npos ? input.size() : end + 1;
+      }
+      evaluator->Run(input.substr(0, end));
+      input.remove_prefix(end);
+    }
+  } catch (...) {
+    munmap(data, size);
+    throw;
+  }
+  munmap(data, size);
+}
+
+// Evaluates a pipe or terminal, cutting what was read at the last complete
+// line and keeping the rest for the next block.
+void RunStreamed(int fd, Evaluator *evaluator) {
+  std::string buffer(kBlockSize, '\0');
+  size_t filled = 0;
+  bool eof = false;
+  while (!eof) {
+    if (filled == buffer.size()) {
+      // A line longer than a block.
+      buffer.resize(buffer.size() * 2);
+    }
+    ssize_t n = read(fd, buffer.data() + filled, buffer.size() - filled);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(),
+                              "failed to read input");
+    }
+    filled += n;
+    eof = n == 0;
+    if (!eof && filled < buffer.size()) {
+      continue;
+    }
+    std::string_view data(buffer.data(), filled);
+    size_t end = eof ? filled : data.rfind('\n') + 1;
+    if (end == 0) {
+      continue;
+    }
+    evaluator->Run(data.substr(0, end));
+    std::copy(buffer.begin() + end, buffer.begin() + filled, buffer.begin());
+    filled -= end;
+  }
+}
+
+} // namespace
+
+void RunBatch(int in_fd, int out_fd, int threads) {
+  Evaluator evaluator(std::max(threads, 1), out_fd);
+  struct stat st;
+  if (fstat(in_fd, &st) == 0 && S_ISREG(st.st_mode)) {
+    RunMapped(in_fd, st.st_size, &evaluator);
+  } else {
+    RunStreamed(in_fd, &evaluator);
+  }
+}
+
+} // namespace myproject
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace myproject {
+
+// Reads `<op> <a> <b>` records, one per line, from `in_fd` and writes their
+// results to `out_fd`, one per line and in the same order. `<op>` is add,
+// multiply or slow_multiply, and empty lines are skipped.
+//
+// A regular file is mapped, anything else is read in blocks. Each block is
+// split into one chunk per thread, and every chunk evaluates its records with
+// the batch functions and formats its results into a buffer of its own, which
+// is written with a single write.
+//
+// Throws std::runtime_error on an invalid record, and std::system_error if
+// reading or writing fails.
+void RunBatch(int in_fd, int out_fd, int threads);
+
+} // namespace myproject
@@ -1,13 +1,71 @@
+#include <exception>
+#include <fcntl.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unistd.h>
+
 #include <fmt/core.h>
 
+#include "bin/batch.h"
 #include "lib/add.h"
+#include "lib/add_inline.h"
+#include "lib/flags.h"
 #include "lib/mul.h"
+#include "lib/mul_inline.h"
 #include "lib/slow_mul.h"
+#include "lib/slow_mul_inline.h"
+
+static_assert(myproject::inlined::add(1, 2) == 3);
+static_assert(myproject::inlined::multiply(4, 3) == 12);
+static_assert(myproject::inlined::slow_multiply(4, -3) == -12);
 
-int main() {
+int main(int argc, char **argv) {
+  if (argc == 1) {
+    fmt::println("1 + 2 = {}", myproject::add(1, 2));
+    fmt::println("4 * 3 = {}", myproject::multiply(4, 3));
+    fmt::println("4 * 3 = {}", myproject::slow_multiply(4, 3));
+    return 0;
+  }
 
-  fmt::println("1 + 2 = {}", myproject::add(1, 2));
-  fmt::println("4 * 3 = {}", myproject::multiply(4, 3));
-  fmt::println("4 * 3 = {}", myproject::slow_multiply(4, 3));
+  // Batch mode, see bin/batch.h.
+  std::string threads = std::to_string(std::thread::hardware_concurrency());
+  std::string input;
+  for (int i = 1; i < argc; ++i) {
+    if (myproject::ParseFlag(argv[i], "threads", &threads)) {
+      continue;
+    }
+    if (input.empty() && !std::string_view(argv[i]).starts_with("--")) {
+      input = argv[i];
+      continue;
+    }
+    input.clear();
+    break;
+  }
+  if (input.empty()) {
+    fmt::println(stderr, "usage: {} [--threads=<count>] <file>|-", argv[0]);
+    return 1;
+  }
+  int thread_count;
+  try {
+    thread_count = std::stoi(threads);
+  } catch (const std::exception &) {
+    fmt::println(stderr, "invalid --threads: {}", threads);
+    return 1;
+  }
+  int fd = STDIN_FILENO;
+  if (input != "-") {
+    fd = open(input.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      fmt::println(stderr, "failed to open {}", input);
+      return 1;
+    }
+  }
+  try {
+    myproject::RunBatch(fd, STDOUT_FILENO, thread_count);
+  } catch (const std::exception &e) {
+    fmt::println(stderr, "{}", e.what());
+    return 1;
+  }
   return 0;
 }
@@ -1,7 +1,67 @@
 #include "lib/add.h"
 
+#include <climits>
+#include <cstddef>
+
+#include "lib/add_inline.h"
+#include "lib/simd.h"
+#include "lib/span_sizes.h"
+
 namespace myproject {
+namespace {
+
+MYPROJECT_TARGET_CLONES
+void add_kernel(const int *a, const int *b, int *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = inlined::add(a[i], b[i]);
+  }
+}
+
+// A sum overflowed if its sign differs from the signs of both operands, the
+// sign bit of the result is set then.
+int overflow_bits(int a, int b, int sum) { return (a ^ sum) & (b ^ sum); }
+
+MYPROJECT_TARGET_CLONES
+bool checked_add_kernel(const int *a, const int *b, int *out, size_t n) {
+  int overflow = 0;
+  for (size_t i = 0; i < n; ++i) {
+    int sum = inlined::add(a[i], b[i]);
+    overflow |= overflow_bits(a[i], b[i], sum);
+    out[i] = sum;
+  }
+  return overflow < 0;
+}
+
+MYPROJECT_TARGET_CLONES
+void saturating_add_kernel(const int *a, const int *b, int *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    int sum = inlined::add(a[i], b[i]);
+    // Both operands have the sign of a if it overflowed.
+    int limit = (a[i] >> 31) ^ INT_MAX;
+    out[i] = overflow_bits(a[i], b[i], sum) < 0 ? limit : sum;
+  }
+}
+
+} // namespace
+
+int add(int a, int b) { return inlined::add(a, b); }
+
+void add_n(std::span<const int> a, std::span<const int> b,
+           std::span<int> out) {
+  internal::check_sizes("add_n", a, b, out);
+  add_kernel(a.data(), b.data(), out.data(), out.size());
+}
+
+bool checked_add_n(std::span<const int> a, std::span<const int> b,
+                   std::span<int> out) {
+  internal::check_sizes("checked_add_n", a, b, out);
+  return checked_add_kernel(a.data(), b.data(), out.data(), out.size());
+}
 
-int add(int a, int b) { return a + b; }
+void saturating_add_n(std::span<const int> a, std::span<const int> b,
+                      std::span<int> out) {
+  internal::check_sizes("saturating_add_n", a, b, out);
+  saturating_add_kernel(a.data(), b.data(), out.data(), out.size());
+}
 
 } // namespace myproject
@@ -1,8 +1,27 @@
 #pragma once
 
+#include <span>
+
 namespace myproject {
 
-// Does what you think :)
+// Does what you think :) Wraps around on overflow, modulo 2^32. See
+// add_inline.h for a version the compiler can inline.
 int add(int, int);
 
+// out[i] = add(a[i], b[i]), in one call for all of them. The spans must have
+// the same size, out may be a or b.
+//
+// Throws std::invalid_argument if the sizes differ.
+void add_n(std::span<const int> a, std::span<const int> b, std::span<int> out);
+
+// add_n, but returns whether any of the sums overflowed, those are wrapped in
+// out like add does. The overflows are collected without a branch per
+// element, so this is as fast as add_n. See checked.h for single values.
+bool checked_add_n(std::span<const int> a, std::span<const int> b,
+                   std::span<int> out);
+
+// add_n, but sums that overflow are clamped to INT_MIN or INT_MAX.
+void saturating_add_n(std::span<const int> a, std::span<const int> b,
+                      std::span<int> out);
+
 } // namespace myproject
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace myproject::inlined {
+
+// add from add.h, but inlined and usable in constant expressions. Wraps
+// around on overflow, modulo 2^32.
+constexpr int add(int a, int b) {
+  return static_cast<int>(static_cast<unsigned>(a) + static_cast<unsigned>(b));
+}
+
+} // namespace myproject::inlined
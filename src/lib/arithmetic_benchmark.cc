@@ -0,0 +1,68 @@
+#include <random>
+#include <span>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "lib/add.h"
+#include "lib/add_inline.h"
+#include "lib/mul.h"
+#include "lib/mul_inline.h"
+
+// add and multiply one call per element, versus add_n and multiply_n for all
+// of them, with the inline versions as the baseline. The scalar calls cross
+// into the library, through the PLT with shared libraries (unless LANDLOCK_LTO
+// inlines them), so comparing the results of the release and release-static
+// presets shows what that costs.
+
+namespace {
+
+// `size` random operands.
+std::vector<int> Operands(size_t size, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> value;
+  std::vector<int> operands(size);
+  for (int &operand : operands) {
+    operand = value(rng);
+  }
+  return operands;
+}
+
+// One call of Op per element.
+template <auto Op> void BM_Scalar(benchmark::State &state) {
+  auto a = Operands(state.range(0), 1);
+  auto b = Operands(state.range(0), 2);
+  std::vector<int> out(a.size());
+  for (auto _ : state) {
+    for (size_t i = 0; i < out.size(); ++i) {
+      out[i] = Op(a[i], b[i]);
+    }
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Scalar<myproject::add>)->Range(64, 16 << 10);
+BENCHMARK(BM_Scalar<myproject::inlined::add>)->Range(64, 16 << 10);
+BENCHMARK(BM_Scalar<myproject::multiply>)->Range(64, 16 << 10);
+BENCHMARK(BM_Scalar<myproject::inlined::multiply>)->Range(64, 16 << 10);
+
+// One call of Op for all elements.
+void BM_Batch(benchmark::State &state,
+              void (*op)(std::span<const int>, std::span<const int>,
+                         std::span<int>)) {
+  auto a = Operands(state.range(0), 1);
+  auto b = Operands(state.range(0), 2);
+  std::vector<int> out(a.size());
+  for (auto _ : state) {
+    op(a, b, out);
+    benchmark::DoNotOptimize(out.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_CAPTURE(BM_Batch, add_n, myproject::add_n)->Range(64, 16 << 10);
+BENCHMARK_CAPTURE(BM_Batch, multiply_n, myproject::multiply_n)
+    ->Range(64, 16 << 10);
+
+} // namespace
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "lib/add.h"
+#include "lib/add_inline.h"
+#include "lib/checked.h"
+#include "lib/mul.h"
+#include "lib/mul_inline.h"
+#include "lib/slow_mul.h"
+#include "lib/slow_mul_inline.h"
+
+namespace myproject {
+namespace {
+
+// Constant evaluation rejects signed overflow, so these also prove the
+// inline versions free of it.
+static_assert(inlined::add(INT_MAX, 1) == INT_MIN);
+static_assert(inlined::multiply(INT_MIN, -1) == INT_MIN);
+static_assert(inlined::multiply(65536, 65536) == 0);
+static_assert(inlined::slow_multiply(INT_MIN, -1) == INT_MIN);
+static_assert(inlined::slow_multiply(INT_MAX, INT_MAX) == 1);
+static_assert(inlined::slow_multiply(INT_MAX, INT_MAX,
+                                     MultiplyStrategy::kDirect) == 1);
+static_assert(!checked_multiply(INT_MIN, -1));
+static_assert(saturating_add(INT_MIN, -1) == INT_MIN);
+
+int Wrap(int64_t value) {
+  return static_cast<int>(static_cast<uint32_t>(value));
+}
+
+bool Fits(int64_t value) { return value >= INT_MIN && value <= INT_MAX; }
+
+int Clamp(int64_t value) {
+  return static_cast<int>(std::clamp<int64_t>(value, INT_MIN, INT_MAX));
+}
+
+// Operands around the edges of int, and random ones over its whole range.
+std::vector<int> Operands(size_t random, unsigned seed) {
+  std::vector<int> operands = {INT_MIN, INT_MIN + 1, -65536, -46341, -1, 0,
+                               1,       46341,       65536,  INT_MAX - 1,
+                               INT_MAX};
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> value(INT_MIN, INT_MAX);
+  for (size_t i = 0; i < random; ++i) {
+    operands.push_back(value(rng));
+  }
+  return operands;
+}
+
+TEST(ArithmeticTest, ScalarWrapsAround) {
+  for (int a : Operands(100, 1)) {
+    for (int b : Operands(100, 2)) {
+      int sum = Wrap(int64_t{a} + b);
+      int product = Wrap(int64_t{a} * b);
+      EXPECT_EQ(add(a, b), sum) << a << " + " << b;
+      EXPECT_EQ(inlined::add(a, b), sum) << a << " + " << b;
+      EXPECT_EQ(multiply(a, b), product) << a << " * " << b;
+      EXPECT_EQ(inlined::multiply(a, b), product) << a << " * " << b;
+      EXPECT_EQ(slow_multiply(a, b), product) << a << " * " << b;
+      EXPECT_EQ(slow_multiply(a, b, MultiplyStrategy::kDirect), product)
+          << a << " * " << b;
+      EXPECT_EQ(inlined::slow_multiply(a, b), product) << a << " * " << b;
+    }
+  }
+}
+
+TEST(ArithmeticTest, CheckedAndSaturating) {
+  for (int a : Operands(100, 3)) {
+    for (int b : Operands(100, 4)) {
+      int64_t sum = int64_t{a} + b;
+      int64_t product = int64_t{a} * b;
+      EXPECT_EQ(checked_add(a, b),
+                Fits(sum) ? std::optional<int>(sum) : std::nullopt);
+      EXPECT_EQ(checked_multiply(a, b),
+                Fits(product) ? std::optional<int>(product) : std::nullopt);
+      EXPECT_EQ(saturating_add(a, b), Clamp(sum));
+      EXPECT_EQ(saturating_multiply(a, b), Clamp(product));
+    }
+  }
+}
+
+// The batch versions against the reference, for sizes around the vector
+// widths of every target clone, so the remainder loops run too.
+TEST(ArithmeticTest, BatchMatchesScalar) {
+  for (size_t size = 0; size <= 67; ++size) {
+    auto a = Operands(size, size);
+    auto b = Operands(size, size + 1000);
+    auto c = Operands(size, size + 2000);
+    a.resize(size);
+    b.resize(size);
+    c.resize(size);
+    bool sum_overflow = false;
+    bool product_overflow = false;
+    std::vector<int> sums, products, fused, saturated_sums, saturated_products;
+    for (size_t i = 0; i < size; ++i) {
+      int64_t sum = int64_t{a[i]} + b[i];
+      int64_t product = int64_t{a[i]} * b[i];
+      sum_overflow |= !Fits(sum);
+      product_overflow |= !Fits(product);
+      sums.push_back(Wrap(sum));
+      products.push_back(Wrap(product));
+      fused.push_back(Wrap(int64_t{Wrap(product)} + c[i]));
+      saturated_sums.push_back(Clamp(sum));
+      saturated_products.push_back(Clamp(product));
+    }
+
+    std::vector<int> out(size);
+    add_n(a, b, out);
+    EXPECT_EQ(out, sums) << size;
+    multiply_n(a, b, out);
+    EXPECT_EQ(out, products) << size;
+    multiply_add_n(a, b, c, out);
+    EXPECT_EQ(out, fused) << size;
+    EXPECT_EQ(checked_add_n(a, b, out), sum_overflow) << size;
+    EXPECT_EQ(out, sums) << size;
+    EXPECT_EQ(checked_multiply_n(a, b, out), product_overflow) << size;
+    EXPECT_EQ(out, products) << size;
+    saturating_add_n(a, b, out);
+    EXPECT_EQ(out, saturated_sums) << size;
+    saturating_multiply_n(a, b, out);
+    EXPECT_EQ(out, saturated_products) << size;
+  }
+}
+
+TEST(ArithmeticTest, BatchOutputMayAlias) {
+  std::vector<int> a = {1, INT_MAX, -3};
+  std::vector<int> b = {2, 1, 4};
+  add_n(a, b, a);
+  EXPECT_EQ(a, (std::vector<int>{3, INT_MIN, 1}));
+  multiply_n(a, b, b);
+  EXPECT_EQ(b, (std::vector<int>{6, INT_MIN, 4}));
+}
+
+TEST(ArithmeticTest, BatchRejectsDifferentSizes) {
+  std::vector<int> a(3), b(4), out(3);
+  EXPECT_THROW(add_n(a, b, out), std::invalid_argument);
+  EXPECT_THROW(multiply_n(a, b, out), std::invalid_argument);
+  EXPECT_THROW(checked_add_n(a, a, b), std::invalid_argument);
+  EXPECT_THROW(saturating_multiply_n(a, a, b), std::invalid_argument);
+  EXPECT_THROW(multiply_add_n(a, a, b, out), std::invalid_argument);
+}
+
+} // namespace
+} // namespace myproject
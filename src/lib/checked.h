@@ -0,0 +1,43 @@
+#pragma once
+
+#include <climits>
+#include <optional>
+
+namespace myproject {
+
+// add and multiply that report overflow instead of wrapping, nullopt if the
+// result doesn't fit. See add.h and mul.h for the batch versions.
+constexpr std::optional<int> checked_add(int a, int b) {
+  int r;
+  if (__builtin_add_overflow(a, b, &r)) {
+    return std::nullopt;
+  }
+  return r;
+}
+
+constexpr std::optional<int> checked_multiply(int a, int b) {
+  int r;
+  if (__builtin_mul_overflow(a, b, &r)) {
+    return std::nullopt;
+  }
+  return r;
+}
+
+// add and multiply that clamp to INT_MIN or INT_MAX instead of wrapping.
+constexpr int saturating_add(int a, int b) {
+  int r;
+  if (__builtin_add_overflow(a, b, &r)) {
+    return a < 0 ? INT_MIN : INT_MAX;
+  }
+  return r;
+}
+
+constexpr int saturating_multiply(int a, int b) {
+  int r;
+  if (__builtin_mul_overflow(a, b, &r)) {
+    return (a < 0) != (b < 0) ? INT_MIN : INT_MAX;
+  }
+  return r;
+}
+
+} // namespace myproject
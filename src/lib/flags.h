@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace myproject {
+
+// Parses `--<name>=<value>`, returning false if `arg` is a different flag.
+inline bool ParseFlag(std::string_view arg, std::string_view name,
+                      std::string *value) {
+  if (!arg.starts_with("--") || !arg.substr(2).starts_with(name) ||
+      arg.substr(2 + name.size(), 1) != "=") {
+    return false;
+  }
+  *value = arg.substr(3 + name.size());
+  return true;
+}
+
+} // namespace myproject
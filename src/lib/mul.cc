@@ -1,7 +1,82 @@
 #include "lib/mul.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+
+#include "lib/add_inline.h"
+#include "lib/mul_inline.h"
+#include "lib/simd.h"
+#include "lib/span_sizes.h"
+
 namespace myproject {
+namespace {
+
+MYPROJECT_TARGET_CLONES
+void multiply_kernel(const int *a, const int *b, int *out, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = inlined::multiply(a[i], b[i]);
+  }
+}
+
+MYPROJECT_TARGET_CLONES
+void multiply_add_kernel(const int *a, const int *b, const int *c, int *out,
+                         size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    out[i] = inlined::add(inlined::multiply(a[i], b[i]), c[i]);
+  }
+}
+
+// The products are computed in 64 bits, they overflowed if they don't
+// survive the round trip through int.
+MYPROJECT_TARGET_CLONES
+bool checked_multiply_kernel(const int *a, const int *b, int *out, size_t n) {
+  int64_t overflow = 0;
+  for (size_t i = 0; i < n; ++i) {
+    int64_t product = int64_t{a[i]} * b[i];
+    overflow |= product ^ static_cast<int>(product);
+    out[i] = static_cast<int>(product);
+  }
+  return overflow != 0;
+}
+
+MYPROJECT_TARGET_CLONES
+void saturating_multiply_kernel(const int *a, const int *b, int *out,
+                                size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    int64_t product = int64_t{a[i]} * b[i];
+    out[i] = static_cast<int>(
+        std::clamp<int64_t>(product, INT_MIN, INT_MAX));
+  }
+}
+
+} // namespace
+
+int multiply(int a, int b) { return inlined::multiply(a, b); }
+
+void multiply_n(std::span<const int> a, std::span<const int> b,
+                std::span<int> out) {
+  internal::check_sizes("multiply_n", a, b, out);
+  multiply_kernel(a.data(), b.data(), out.data(), out.size());
+}
+
+bool checked_multiply_n(std::span<const int> a, std::span<const int> b,
+                        std::span<int> out) {
+  internal::check_sizes("checked_multiply_n", a, b, out);
+  return checked_multiply_kernel(a.data(), b.data(), out.data(), out.size());
+}
+
+void saturating_multiply_n(std::span<const int> a, std::span<const int> b,
+                           std::span<int> out) {
+  internal::check_sizes("saturating_multiply_n", a, b, out);
+  saturating_multiply_kernel(a.data(), b.data(), out.data(), out.size());
+}
 
-int multiply(int a, int b) { return a * b; }
+void multiply_add_n(std::span<const int> a, std::span<const int> b,
+                    std::span<const int> c, std::span<int> out) {
+  internal::check_sizes("multiply_add_n", a, b, c, out);
+  multiply_add_kernel(a.data(), b.data(), c.data(), out.data(), out.size());
+}
 
 } // namespace myproject
@@ -1,8 +1,33 @@
 #pragma once
 
+#include <span>
+
 namespace myproject {
 
-// Does what you think it does :)
+// Does what you think it does :) Wraps around on overflow, modulo 2^32. See
+// mul_inline.h for a version the compiler can inline.
 int multiply(int, int);
 
+// out[i] = multiply(a[i], b[i]), in one call for all of them, wrapping modulo
+// 2^32. The spans must have the same size, out may be a or b.
+//
+// Throws std::invalid_argument if the sizes differ.
+void multiply_n(std::span<const int> a, std::span<const int> b,
+                std::span<int> out);
+
+// multiply_n, but returns whether any of the products overflowed, those
+// wrap around in out. The overflows are collected without a branch per
+// element, so this vectorizes like multiply_n. See checked.h for single
+// values.
+bool checked_multiply_n(std::span<const int> a, std::span<const int> b,
+                        std::span<int> out);
+
+// multiply_n, but products that overflow are clamped to INT_MIN or INT_MAX.
+void saturating_multiply_n(std::span<const int> a, std::span<const int> b,
+                           std::span<int> out);
+
+// out[i] = a[i] * b[i] + c[i], like multiply_n, wrapping modulo 2^32.
+void multiply_add_n(std::span<const int> a, std::span<const int> b,
+                    std::span<const int> c, std::span<int> out);
+
 } // namespace myproject
@@ -0,0 +1,11 @@
+#pragma once
+
+namespace myproject::inlined {
+
+// multiply from mul.h, but inlined and usable in constant expressions. Wraps
+// around on overflow, modulo 2^32.
+constexpr int multiply(int a, int b) {
+  return static_cast<int>(static_cast<unsigned>(a) * static_cast<unsigned>(b));
+}
+
+} // namespace myproject::inlined
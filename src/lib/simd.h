@@ -0,0 +1,12 @@
+#pragma once
+
+// Compiles a function once per x86 instruction set, and the loader picks the
+// best one for the CPU (an ifunc), so its loops are vectorized with the widest
+// registers there are. Other architectures get their baseline, e.g. NEON on
+// aarch64.
+#if defined(__x86_64__) && defined(__ELF__)
+#define MYPROJECT_TARGET_CLONES                                                \
+  __attribute__((target_clones("avx512f", "avx2", "sse4.2", "default")))
+#else
+#define MYPROJECT_TARGET_CLONES
+#endif
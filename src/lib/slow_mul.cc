@@ -1,15 +1,54 @@
 #include "lib/slow_mul.h"
 
+#include <bit>
+#include <utility>
+
 #include "lib/add.h"
 
 namespace myproject {
+namespace {
 
-int slow_multiply(int a, int b) {
+unsigned magnitude(int v) {
+  return v < 0 ? 0u - static_cast<unsigned>(v) : static_cast<unsigned>(v);
+}
+
+int negate(int v) { return static_cast<int>(0u - static_cast<unsigned>(v)); }
+
+// Like inlined::slow_multiply, but through the out-of-line add.
+int shift_add_multiply(int a, int b) {
+  // The product modulo 2^32 is the same no matter which operand is doubled,
+  // and the sign of b is applied at the end.
+  if (std::bit_width(magnitude(a)) < std::bit_width(magnitude(b))) {
+    std::swap(a, b);
+  }
+  unsigned bits = magnitude(b);
   int r = 0;
-  for (int i = 0; i < b; ++i) {
-    r = add(r, a);
+  while (bits) {
+    if (bits & 1) {
+      r = add(r, a);
+    }
+    bits >>= 1;
+    if (bits) {
+      a = add(a, a);
+    }
+  }
+  return b < 0 ? negate(r) : r;
+}
+
+} // namespace
+
+int slow_multiply(int a, int b) {
+  return slow_multiply(a, b, MultiplyStrategy::kShiftAdd);
+}
+
+int slow_multiply(int a, int b, MultiplyStrategy strategy) {
+  switch (strategy) {
+  case MultiplyStrategy::kShiftAdd:
+    return shift_add_multiply(a, b);
+  case MultiplyStrategy::kDirect:
+    break;
   }
-  return r;
+  return inlined::slow_multiply(a, b, MultiplyStrategy::kDirect);
 }
 
 } // namespace myproject
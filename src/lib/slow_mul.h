@@ -1,8 +1,15 @@
 #pragma once
 
+#include "lib/slow_mul_inline.h"
+
 namespace myproject {
 
-// Does what you think it does :)
+// Does what you think it does :) Negative operands are fine, and a product
+// that doesn't fit wraps around (modulo 2^32, like add), for every strategy.
+// See slow_mul_inline.h for a version the compiler can inline.
 int slow_multiply(int, int);
 
+// Same as above, with an explicit strategy.
+int slow_multiply(int, int, MultiplyStrategy);
+
 } // namespace myproject
@@ -0,0 +1,61 @@
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "lib/mul.h"
+#include "lib/slow_mul.h"
+
+// Latency of slow_multiply by strategy and operand size, with multiply as the
+// baseline. Shift-and-add takes a step per bit of the smaller operand, which
+// the complexity fit over the operand sizes (in bits) should show as O(N).
+
+namespace {
+
+using myproject::MultiplyStrategy;
+
+// Pairs of operands with up to `bits` bits and random signs.
+std::vector<std::pair<int, int>> Operands(int bits) {
+  std::mt19937 rng(bits);
+  std::uniform_int_distribution<int> value(0, (1 << (bits - 1)) - 1);
+  std::bernoulli_distribution negative;
+  std::vector<std::pair<int, int>> operands(1024);
+  for (auto &[a, b] : operands) {
+    a = negative(rng) ? -value(rng) : value(rng);
+    b = negative(rng) ? -value(rng) : value(rng);
+  }
+  return operands;
+}
+
+void BM_SlowMultiply(benchmark::State &state, MultiplyStrategy strategy) {
+  auto operands = Operands(state.range(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    const auto &[a, b] = operands[i++ % operands.size()];
+    benchmark::DoNotOptimize(myproject::slow_multiply(a, b, strategy));
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK_CAPTURE(BM_SlowMultiply, shift_add, MultiplyStrategy::kShiftAdd)
+    ->DenseRange(2, 30, 4)
+    ->Arg(31)
+    ->Complexity(benchmark::oN);
+BENCHMARK_CAPTURE(BM_SlowMultiply, direct, MultiplyStrategy::kDirect)
+    ->DenseRange(2, 30, 4)
+    ->Arg(31)
+    ->Complexity(benchmark::o1);
+
+void BM_Multiply(benchmark::State &state) {
+  auto operands = Operands(state.range(0));
+  size_t i = 0;
+  for (auto _ : state) {
+    const auto &[a, b] = operands[i++ % operands.size()];
+    benchmark::DoNotOptimize(myproject::multiply(a, b));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Multiply)->DenseRange(2, 30, 4)->Arg(31);
+
+} // namespace
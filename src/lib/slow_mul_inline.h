@@ -0,0 +1,50 @@
+#pragma once
+
+#include <bit>
+#include <utility>
+
+#include "lib/add_inline.h"
+
+namespace myproject {
+
+// How slow_multiply computes the product.
+enum class MultiplyStrategy {
+  // Doubles the operand with fewer bits and adds it for every set bit of the
+  // other, O(log) calls to add.
+  kShiftAdd,
+  // A single multiplication.
+  kDirect,
+};
+
+namespace inlined {
+
+// slow_multiply from slow_mul.h, but inlined and usable in constant
+// expressions. Wraps around like it.
+constexpr int slow_multiply(int a, int b, MultiplyStrategy strategy =
+                                              MultiplyStrategy::kShiftAdd) {
+  auto magnitude = [](int v) {
+    return v < 0 ? 0u - static_cast<unsigned>(v) : static_cast<unsigned>(v);
+  };
+  if (strategy == MultiplyStrategy::kDirect) {
+    return static_cast<int>(static_cast<unsigned>(a) *
+                            static_cast<unsigned>(b));
+  }
+  if (std::bit_width(magnitude(a)) < std::bit_width(magnitude(b))) {
+    std::swap(a, b);
+  }
+  unsigned bits = magnitude(b);
+  int r = 0;
+  while (bits) {
+    if (bits & 1) {
+      r = add(r, a);
+    }
+    bits >>= 1;
+    if (bits) {
+      a = add(a, a);
+    }
+  }
+  return b < 0 ? static_cast<int>(0u - static_cast<unsigned>(r)) : r;
+}
+
+} // namespace inlined
+} // namespace myproject
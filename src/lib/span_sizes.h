@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+
+namespace myproject::internal {
+
+// Throws std::invalid_argument unless all spans passed to the batch function
+// `name` have the same size. The kernels index them all by the first.
+template <typename First, typename... Rest>
+void check_sizes(const char *name, const First &first, const Rest &...rest) {
+  if (((rest.size() != first.size()) || ...)) {
+    throw std::invalid_argument(std::string(name) +
+                                ": spans of different sizes");
+  }
+}
+
+} // namespace myproject::internal
@@ -0,0 +1,70 @@
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <pthread.h>
+#include <string>
+#include <thread>
+
+#include <fmt/core.h>
+#include <grpcpp/grpcpp.h>
+
+#include "lib/flags.h"
+#include "service/arithmetic_service.h"
+
+namespace {
+
+// How long streams that are still open get to finish once the server is
+// asked to stop, before they are cancelled.
+constexpr auto kShutdownGracePeriod = std::chrono::seconds(5);
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string listen = "127.0.0.1:8981";
+  std::string queues = "0";
+  for (int i = 1; i < argc; ++i) {
+    if (myproject::ParseFlag(argv[i], "listen", &listen) ||
+        myproject::ParseFlag(argv[i], "queues", &queues)) {
+      continue;
+    }
+    fmt::println(stderr, "usage: {} [--listen=<address>] [--queues=<count>]",
+                 argv[0]);
+    return 1;
+  }
+  int queue_count;
+  try {
+    queue_count = std::stoi(queues);
+  } catch (const std::exception &) {
+    fmt::println(stderr, "invalid --queues: {}", queues);
+    return 1;
+  }
+
+  // Blocked before gRPC starts any threads, so only the one waiting for them
+  // below sees them.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort(listen, grpc::InsecureServerCredentials());
+  builder.SetMaxReceiveMessageSize(myproject::kMaxComputeMessageSize);
+  builder.SetMaxSendMessageSize(myproject::kMaxComputeMessageSize);
+  myproject::ArithmeticServer arithmetic(&builder, queue_count);
+  std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+  if (!server) {
+    fmt::println(stderr, "failed to listen on {}", listen);
+    return 1;
+  }
+  fmt::println(stderr, "arithmetic server listening on {}", listen);
+  std::thread shutdown([&] {
+    int sig;
+    sigwait(&signals, &sig);
+    fmt::println(stderr, "arithmetic server shutting down");
+    server->Shutdown(std::chrono::system_clock::now() + kShutdownGracePeriod);
+  });
+  arithmetic.Run(server.get());
+  shutdown.join();
+  return 0;
+}
@@ -0,0 +1,181 @@
+#include "service/arithmetic_service.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <thread>
+
+#include <google/protobuf/arena.h>
+
+#include "lib/add.h"
+#include "lib/mul.h"
+#include "lib/slow_mul.h"
+
+namespace myproject {
+namespace {
+
+// Plenty for the messages and the repeated fields of typical batches, larger
+// ones continue on the heap.
+constexpr size_t kInitialArenaBlock = 16 * 1024;
+
+// One Compute stream. It waits for a single event at a time, reading a
+// request, then writing its response, and so on until the client is done.
+class ComputeCall {
+public:
+  ComputeCall(arithmetic::Arithmetic::AsyncService *service,
+              grpc::ServerCompletionQueue *queue)
+      : service_(service), queue_(queue), arena_(MakeArenaOptions()),
+        request_(google::protobuf::Arena::CreateMessage<
+                 arithmetic::ComputeRequest>(&arena_)),
+        response_(google::protobuf::Arena::CreateMessage<
+                  arithmetic::ComputeResponse>(&arena_)) {
+    service_->RequestCompute(&context_, &stream_, queue_, queue_, this);
+  }
+
+  // Handles the event the call waited for, `ok` as the queue reported it.
+  void Proceed(bool ok);
+
+private:
+  enum class State { kAccepting, kReading, kWriting, kFinishing };
+
+  google::protobuf::ArenaOptions MakeArenaOptions() {
+    google::protobuf::ArenaOptions options;
+    options.initial_block = initial_block_;
+    options.initial_block_size = sizeof(initial_block_);
+    return options;
+  }
+
+  void Finish(const grpc::Status &status) {
+    state_ = State::kFinishing;
+    stream_.Finish(status, this);
+  }
+
+  arithmetic::Arithmetic::AsyncService *service_;
+  grpc::ServerCompletionQueue *queue_;
+  grpc::ServerContext context_;
+  grpc::ServerAsyncReaderWriter<arithmetic::ComputeResponse,
+                                arithmetic::ComputeRequest>
+      stream_{&context_};
+  alignas(std::max_align_t) char initial_block_[kInitialArenaBlock];
+  google::protobuf::Arena arena_;
+  arithmetic::ComputeRequest *request_;
+  arithmetic::ComputeResponse *response_;
+  State state_ = State::kAccepting;
+};
+
+void ComputeCall::Proceed(bool ok) {
+  switch (state_) {
+  case State::kAccepting:
+    if (!ok) {
+      // The server is shutting down.
+      delete this;
+      return;
+    }
+    new ComputeCall(service_, queue_);
+    state_ = State::kReading;
+    stream_.Read(request_, this);
+    return;
+  case State::kReading: {
+    if (!ok) {
+      // The client is done writing.
+      Finish(grpc::Status::OK);
+      return;
+    }
+    auto status = Compute(*request_, response_);
+    if (!status.ok()) {
+      Finish(status);
+      return;
+    }
+    state_ = State::kWriting;
+    stream_.Write(*response_, this);
+    return;
+  }
+  case State::kWriting:
+    if (!ok) {
+      Finish(grpc::Status(grpc::StatusCode::CANCELLED, "stream closed"));
+      return;
+    }
+    state_ = State::kReading;
+    stream_.Read(request_, this);
+    return;
+  case State::kFinishing:
+    delete this;
+    return;
+  }
+}
+
+} // namespace
+
+grpc::Status Compute(const arithmetic::ComputeRequest &request,
+                     arithmetic::ComputeResponse *response) {
+  if (request.a_size() != request.b_size()) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                        "a and b have different lengths");
+  }
+  std::span<const int> a(request.a().data(), request.a_size());
+  std::span<const int> b(request.b().data(), request.b_size());
+  // Keeps the capacity of the previous response of the stream.
+  auto *results = response->mutable_results();
+  results->Resize(request.a_size(), 0);
+  std::span<int> out(results->mutable_data(), results->size());
+  switch (request.operation()) {
+  case arithmetic::ADD:
+    add_n(a, b, out);
+    return grpc::Status::OK;
+  case arithmetic::MULTIPLY:
+    multiply_n(a, b, out);
+    return grpc::Status::OK;
+  case arithmetic::SLOW_MULTIPLY:
+    for (size_t i = 0; i < out.size(); ++i) {
+      out[i] = slow_multiply(a[i], b[i]);
+    }
+    return grpc::Status::OK;
+  default:
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                        "unknown operation");
+  }
+}
+
+ArithmeticServer::ArithmeticServer(grpc::ServerBuilder *builder, int queues) {
+  if (queues <= 0) {
+    queues = std::max(1u, std::thread::hardware_concurrency());
+  }
+  builder->RegisterService(&service_);
+  for (int i = 0; i < queues; ++i) {
+    queues_.push_back(builder->AddCompletionQueue());
+  }
+}
+
+ArithmeticServer::~ArithmeticServer() {
+  for (auto &queue : queues_) {
+    queue->Shutdown();
+    void *tag;
+    bool ok;
+    while (queue->Next(&tag, &ok)) {
+      static_cast<ComputeCall *>(tag)->Proceed(ok);
+    }
+  }
+}
+
+void ArithmeticServer::Run(grpc::Server *server) {
+  std::vector<std::thread> threads;
+  for (auto &queue : queues_) {
+    threads.emplace_back([this, queue = queue.get()] {
+      new ComputeCall(&service_, queue);
+      void *tag;
+      bool ok;
+      while (queue->Next(&tag, &ok)) {
+        static_cast<ComputeCall *>(tag)->Proceed(ok);
+      }
+    });
+  }
+  server->Wait();
+  for (auto &queue : queues_) {
+    queue->Shutdown();
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+} // namespace myproject
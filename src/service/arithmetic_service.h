@@ -0,0 +1,42 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+
+#include "service/arithmetic.grpc.pb.h"
+
+namespace myproject {
+
+// The largest request or response the server accepts, see ComputeRequest.
+inline constexpr int kMaxComputeMessageSize = 1024 * 1024;
+
+// Computes the results of one batch into `response`.
+grpc::Status Compute(const arithmetic::ComputeRequest &request,
+                     arithmetic::ComputeResponse *response);
+
+// The Arithmetic service on the async API, with a completion queue and a
+// thread polling it per core by default. Each stream is served by the queue
+// that accepted it, and reads into the same arena allocated messages for its
+// whole lifetime, so a batch allocates nothing once the first few have grown
+// their repeated fields.
+class ArithmeticServer {
+public:
+  // Registers the service with `builder` and adds `queues` completion queues,
+  // 0 means one per core. `builder` must be started before Run().
+  explicit ArithmeticServer(grpc::ServerBuilder *builder, int queues = 0);
+  ArithmeticServer(const ArithmeticServer &) = delete;
+  ArithmeticServer &operator=(const ArithmeticServer &) = delete;
+  ~ArithmeticServer();
+
+  // Serves until `server` is shut down (arithmetic_server does on SIGINT and
+  // SIGTERM), then drains the queues.
+  void Run(grpc::Server *server);
+
+private:
+  arithmetic::Arithmetic::AsyncService service_;
+  std::vector<std::unique_ptr<grpc::ServerCompletionQueue>> queues_;
+};
+
+} // namespace myproject
@@ -0,0 +1,146 @@
+#include <climits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <grpcpp/grpcpp.h>
+#include <gtest/gtest.h>
+
+#include "lib/add.h"
+#include "lib/mul.h"
+#include "lib/slow_mul.h"
+#include "service/arithmetic_service.h"
+
+namespace myproject {
+namespace {
+
+arithmetic::ComputeRequest MakeRequest(arithmetic::Operation operation,
+                                       const std::vector<int> &a,
+                                       const std::vector<int> &b) {
+  arithmetic::ComputeRequest request;
+  request.set_operation(operation);
+  request.mutable_a()->Add(a.begin(), a.end());
+  request.mutable_b()->Add(b.begin(), b.end());
+  return request;
+}
+
+std::vector<int> Results(const arithmetic::ComputeResponse &response) {
+  return {response.results().begin(), response.results().end()};
+}
+
+const std::vector<int> kA = {0, 1, -7, INT_MAX, INT_MIN, 65536, 12345};
+const std::vector<int> kB = {0, 2, 3, 1, -1, 65536, -678};
+
+TEST(ComputeTest, EachOperation) {
+  struct Case {
+    arithmetic::Operation operation;
+    int (*expected)(int, int);
+  };
+  for (auto [operation, expected] :
+       {Case{arithmetic::ADD, add}, Case{arithmetic::MULTIPLY, multiply},
+        Case{arithmetic::SLOW_MULTIPLY, slow_multiply}}) {
+    arithmetic::ComputeResponse response;
+    ASSERT_TRUE(Compute(MakeRequest(operation, kA, kB), &response).ok());
+    std::vector<int> want;
+    for (size_t i = 0; i < kA.size(); ++i) {
+      want.push_back(expected(kA[i], kB[i]));
+    }
+    EXPECT_EQ(Results(response), want) << operation;
+  }
+}
+
+TEST(ComputeTest, ReusedResponseShrinks) {
+  arithmetic::ComputeResponse response;
+  ASSERT_TRUE(Compute(MakeRequest(arithmetic::ADD, kA, kB), &response).ok());
+  ASSERT_TRUE(Compute(MakeRequest(arithmetic::ADD, {1}, {2}), &response).ok());
+  EXPECT_EQ(Results(response), std::vector{3});
+  ASSERT_TRUE(Compute(MakeRequest(arithmetic::ADD, {}, {}), &response).ok());
+  EXPECT_TRUE(Results(response).empty());
+}
+
+TEST(ComputeTest, RejectsDifferentLengths) {
+  arithmetic::ComputeResponse response;
+  auto status =
+      Compute(MakeRequest(arithmetic::MULTIPLY, {1, 2}, {3}), &response);
+  EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT);
+}
+
+TEST(ComputeTest, RejectsUnknownOperations) {
+  for (int operation : {0, 42}) {
+    arithmetic::ComputeResponse response;
+    auto status = Compute(
+        MakeRequest(static_cast<arithmetic::Operation>(operation), {1}, {2}),
+        &response);
+    EXPECT_EQ(status.error_code(), grpc::StatusCode::INVALID_ARGUMENT)
+        << operation;
+  }
+}
+
+// A server on an in-process channel, so the test needs no network.
+class ArithmeticServerTest : public testing::Test {
+protected:
+  void SetUp() override {
+    grpc::ServerBuilder builder;
+    arithmetic_ = std::make_unique<ArithmeticServer>(&builder, 2);
+    server_ = builder.BuildAndStart();
+    ASSERT_NE(server_, nullptr);
+    thread_ = std::thread([this] { arithmetic_->Run(server_.get()); });
+    stub_ = arithmetic::Arithmetic::NewStub(
+        server_->InProcessChannel(grpc::ChannelArguments()));
+  }
+
+  void TearDown() override {
+    server_->Shutdown();
+    thread_.join();
+  }
+
+  std::unique_ptr<ArithmeticServer> arithmetic_;
+  std::unique_ptr<grpc::Server> server_;
+  std::thread thread_;
+  std::unique_ptr<arithmetic::Arithmetic::Stub> stub_;
+};
+
+TEST_F(ArithmeticServerTest, AnswersEveryBatchInOrder) {
+  grpc::ClientContext context;
+  auto stream = stub_->Compute(&context);
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(stream->Write(MakeRequest(arithmetic::ADD, {i, i}, {1, 2})));
+    arithmetic::ComputeResponse response;
+    ASSERT_TRUE(stream->Read(&response));
+    EXPECT_EQ(Results(response), (std::vector{i + 1, i + 2}));
+  }
+  ASSERT_TRUE(stream->WritesDone());
+  arithmetic::ComputeResponse response;
+  EXPECT_FALSE(stream->Read(&response));
+  EXPECT_TRUE(stream->Finish().ok());
+}
+
+TEST_F(ArithmeticServerTest, InvalidBatchEndsTheStream) {
+  grpc::ClientContext context;
+  auto stream = stub_->Compute(&context);
+  ASSERT_TRUE(stream->Write(MakeRequest(arithmetic::MULTIPLY, {1}, {})));
+  arithmetic::ComputeResponse response;
+  EXPECT_FALSE(stream->Read(&response));
+  EXPECT_EQ(stream->Finish().error_code(),
+            grpc::StatusCode::INVALID_ARGUMENT);
+}
+
+TEST_F(ArithmeticServerTest, ServesStreamsConcurrently) {
+  grpc::ClientContext first_context, second_context;
+  auto first = stub_->Compute(&first_context);
+  auto second = stub_->Compute(&second_context);
+  ASSERT_TRUE(first->Write(MakeRequest(arithmetic::ADD, {1}, {1})));
+  ASSERT_TRUE(second->Write(MakeRequest(arithmetic::MULTIPLY, {3}, {4})));
+  arithmetic::ComputeResponse response;
+  ASSERT_TRUE(second->Read(&response));
+  EXPECT_EQ(Results(response), std::vector{12});
+  ASSERT_TRUE(first->Read(&response));
+  EXPECT_EQ(Results(response), std::vector{2});
+  ASSERT_TRUE(first->WritesDone());
+  ASSERT_TRUE(second->WritesDone());
+  EXPECT_TRUE(first->Finish().ok());
+  EXPECT_TRUE(second->Finish().ok());
+}
+
+} // namespace
+} // namespace myproject
@@ -0,0 +1,73 @@
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <fmt/core.h>
+#include <grpcpp/grpcpp.h>
+
+#include "lib/flags.h"
+#include "service/cache_service.h"
+#include "service/credentials.h"
+#include "service/rpc_limits.h"
+
+int main(int argc, char **argv) {
+  std::string listen = "127.0.0.1:8980";
+  std::string root, token_file, tls_cert, tls_key;
+  myproject::CacheAccess access;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string_view(argv[i]) == "--read_only") {
+      access.read_only = true;
+      continue;
+    }
+    if (myproject::ParseFlag(argv[i], "listen", &listen) ||
+        myproject::ParseFlag(argv[i], "root", &root) ||
+        myproject::ParseFlag(argv[i], "token_file", &token_file) ||
+        myproject::ParseFlag(argv[i], "tls_cert", &tls_cert) ||
+        myproject::ParseFlag(argv[i], "tls_key", &tls_key)) {
+      continue;
+    }
+    fmt::println(stderr,
+                 "usage: {} --root=<cache directory> [--listen=<address>] "
+                 "[--token_file=<file>] [--tls_cert=<pem> --tls_key=<pem>] "
+                 "[--read_only]",
+                 argv[0]);
+    return 1;
+  }
+  if (root.empty()) {
+    fmt::println(stderr, "missing --root");
+    return 1;
+  }
+  std::shared_ptr<grpc::ServerCredentials> credentials;
+  try {
+    if (!token_file.empty()) {
+      access.token = myproject::ReadToken(token_file);
+    }
+    credentials = myproject::MakeServerCredentials(tls_cert, tls_key);
+  } catch (const std::exception &ex) {
+    fmt::println(stderr, "{}", ex.what());
+    return 1;
+  }
+  std::filesystem::create_directories(root);
+
+  myproject::DiskStore store(root);
+  myproject::CasService cas(&store, access);
+  myproject::ActionCacheService action_cache(&store, access);
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort(listen, credentials);
+  builder.SetMaxReceiveMessageSize(myproject::kMaxMessageSize);
+  builder.SetMaxSendMessageSize(myproject::kMaxMessageSize);
+  builder.RegisterService(&cas);
+  builder.RegisterService(&action_cache);
+  std::unique_ptr<grpc::Server> server = builder.BuildAndStart();
+  if (!server) {
+    fmt::println(stderr, "failed to listen on {}", listen);
+    return 1;
+  }
+  fmt::println(stderr, "cache server listening on {}, storing in {}{}",
+               listen, root, access.read_only ? " (read only)" : "");
+  server->Wait();
+  return 0;
+}
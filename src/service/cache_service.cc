@@ -0,0 +1,232 @@
+#include "service/cache_service.h"
+
+#include <exception>
+#include <stdexcept>
+#include <system_error>
+
+#include <fmt/format.h>
+
+#include "sandbox/cache.h"
+#include "sandbox/sha256.h"
+
+namespace myproject {
+namespace {
+
+namespace fs = std::filesystem;
+
+fs::path ShardedPath(const fs::path &root, std::string_view kind,
+                     const std::string &hash) {
+  return root / kind / hash.substr(0, 2) / hash;
+}
+
+grpc::Status InvalidDigest(const remote_cache::Digest &digest) {
+  return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                      fmt::format("invalid digest: \"{}\"", digest.hash()));
+}
+
+// Compares in constant time, so the token can't be guessed byte by byte.
+bool SecretEquals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  unsigned char diff = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    diff |= a[i] ^ b[i];
+  }
+  return diff == 0;
+}
+
+} // namespace
+
+grpc::Status CacheAccess::Check(const grpc::ServerContext &context,
+                                bool write) const {
+  if (!token.empty()) {
+    const auto &metadata = context.client_metadata();
+    auto it = metadata.find("authorization");
+    if (it == metadata.end() ||
+        !SecretEquals(std::string_view(it->second.data(), it->second.size()),
+                      "Bearer " + token)) {
+      return grpc::Status(grpc::StatusCode::UNAUTHENTICATED,
+                          "missing or wrong token");
+    }
+  }
+  if (write && read_only) {
+    return grpc::Status(grpc::StatusCode::PERMISSION_DENIED,
+                        "the cache is read only");
+  }
+  return grpc::Status::OK;
+}
+
+bool IsValidHash(std::string_view hash) {
+  return hash.size() == 64 &&
+         hash.find_first_not_of("0123456789abcdef") == std::string_view::npos;
+}
+
+bool DiskStore::HasBlob(const remote_cache::Digest &digest) const {
+  std::error_code ec;
+  auto size = fs::file_size(ShardedPath(root_, "cas", digest.hash()), ec);
+  return !ec && static_cast<int64_t>(size) == digest.size_bytes();
+}
+
+std::optional<std::string>
+DiskStore::ReadBlob(const remote_cache::Digest &digest) const {
+  auto path = ShardedPath(root_, "cas", digest.hash());
+  if (!fs::exists(path)) {
+    return std::nullopt;
+  }
+  return sandbox::ReadFile(path);
+}
+
+void DiskStore::WriteBlob(const remote_cache::Digest &digest,
+                          std::string_view data) const {
+  sandbox::Sha256 hash;
+  hash.Update(data);
+  if (hash.HexDigest() != digest.hash() ||
+      static_cast<int64_t>(data.size()) != digest.size_bytes()) {
+    throw std::invalid_argument(
+        fmt::format("blob does not match digest {}", digest.hash()));
+  }
+  sandbox::WriteFileAtomic(ShardedPath(root_, "cas", digest.hash()), data);
+}
+
+std::optional<remote_cache::ActionResult>
+DiskStore::ReadActionResult(const std::string &key) const {
+  auto path = ShardedPath(root_, "ac", key);
+  if (!fs::exists(path)) {
+    return std::nullopt;
+  }
+  remote_cache::ActionResult result;
+  if (!result.ParseFromString(sandbox::ReadFile(path))) {
+    throw std::runtime_error(fmt::format("corrupt action result {}", key));
+  }
+  return result;
+}
+
+void DiskStore::WriteActionResult(
+    const std::string &key, const remote_cache::ActionResult &result) const {
+  sandbox::WriteFileAtomic(ShardedPath(root_, "ac", key),
+                           result.SerializeAsString());
+}
+
+grpc::Status CasService::FindMissingBlobs(
+    grpc::ServerContext *context,
+    const remote_cache::FindMissingBlobsRequest *request,
+    remote_cache::FindMissingBlobsResponse *response) {
+  if (auto status = access_.Check(*context, false); !status.ok()) {
+    return status;
+  }
+  for (const auto &digest : request->blob_digests()) {
+    if (!IsValidHash(digest.hash())) {
+      return InvalidDigest(digest);
+    }
+    if (!store_->HasBlob(digest)) {
+      *response->add_missing_blob_digests() = digest;
+    }
+  }
+  return grpc::Status::OK;
+}
+
+grpc::Status CasService::BatchUpdateBlobs(
+    grpc::ServerContext *context,
+    const remote_cache::BatchUpdateBlobsRequest *request,
+    remote_cache::BatchUpdateBlobsResponse *) {
+  if (auto status = access_.Check(*context, true); !status.ok()) {
+    return status;
+  }
+  for (const auto &blob : request->requests()) {
+    if (!IsValidHash(blob.digest().hash())) {
+      return InvalidDigest(blob.digest());
+    }
+    try {
+      store_->WriteBlob(blob.digest(), blob.data());
+    } catch (const std::invalid_argument &ex) {
+      return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, ex.what());
+    } catch (const std::exception &ex) {
+      return grpc::Status(grpc::StatusCode::INTERNAL, ex.what());
+    }
+  }
+  return grpc::Status::OK;
+}
+
+grpc::Status
+CasService::BatchReadBlobs(grpc::ServerContext *context,
+                           const remote_cache::BatchReadBlobsRequest *request,
+                           remote_cache::BatchReadBlobsResponse *response) {
+  if (auto status = access_.Check(*context, false); !status.ok()) {
+    return status;
+  }
+  for (const auto &digest : request->digests()) {
+    if (!IsValidHash(digest.hash())) {
+      return InvalidDigest(digest);
+    }
+    try {
+      auto data = store_->ReadBlob(digest);
+      if (!data) {
+        continue;
+      }
+      auto *blob = response->add_responses();
+      *blob->mutable_digest() = digest;
+      *blob->mutable_data() = std::move(*data);
+    } catch (const std::exception &ex) {
+      return grpc::Status(grpc::StatusCode::INTERNAL, ex.what());
+    }
+  }
+  return grpc::Status::OK;
+}
+
+grpc::Status ActionCacheService::GetActionResult(
+    grpc::ServerContext *context,
+    const remote_cache::GetActionResultRequest *request,
+    remote_cache::ActionResult *response) {
+  if (auto status = access_.Check(*context, false); !status.ok()) {
+    return status;
+  }
+  if (!IsValidHash(request->action_key())) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                        "invalid action key");
+  }
+  try {
+    auto result = store_->ReadActionResult(request->action_key());
+    if (!result) {
+      return grpc::Status(grpc::StatusCode::NOT_FOUND, request->action_key());
+    }
+    *response = std::move(*result);
+  } catch (const std::exception &ex) {
+    return grpc::Status(grpc::StatusCode::INTERNAL, ex.what());
+  }
+  return grpc::Status::OK;
+}
+
+grpc::Status ActionCacheService::UpdateActionResult(
+    grpc::ServerContext *context,
+    const remote_cache::UpdateActionResultRequest *request,
+    remote_cache::ActionResult *response) {
+  if (auto status = access_.Check(*context, true); !status.ok()) {
+    return status;
+  }
+  if (!IsValidHash(request->action_key())) {
+    return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT,
+                        "invalid action key");
+  }
+  // An action result must never point at blobs that can't be downloaded.
+  for (const auto &output : request->action_result().output_files()) {
+    if (!IsValidHash(output.digest().hash())) {
+      return InvalidDigest(output.digest());
+    }
+    if (!store_->HasBlob(output.digest())) {
+      return grpc::Status(
+          grpc::StatusCode::FAILED_PRECONDITION,
+          fmt::format("missing blob for {}", output.path()));
+    }
+  }
+  try {
+    store_->WriteActionResult(request->action_key(),
+                              request->action_result());
+  } catch (const std::exception &ex) {
+    return grpc::Status(grpc::StatusCode::INTERNAL, ex.what());
+  }
+  *response = request->action_result();
+  return grpc::Status::OK;
+}
+
+} // namespace myproject
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <grpcpp/grpcpp.h>
+
+#include "service/remote_cache.grpc.pb.h"
+
+namespace myproject {
+
+// Blobs and action results on the local disk of a cache server. The layout is
+// the same as the one of sandbox::LocalCache, except that the action results
+// are serialized ActionResult messages:
+//   <root>/cas/<xx>/<sha256>
+//   <root>/ac/<xx>/<key>
+class DiskStore {
+public:
+  explicit DiskStore(std::filesystem::path root) : root_(std::move(root)) {}
+
+  bool HasBlob(const remote_cache::Digest &digest) const;
+  std::optional<std::string> ReadBlob(const remote_cache::Digest &digest) const;
+  // Throws std::invalid_argument if `data` does not match `digest`.
+  void WriteBlob(const remote_cache::Digest &digest,
+                 std::string_view data) const;
+
+  std::optional<remote_cache::ActionResult>
+  ReadActionResult(const std::string &key) const;
+  void WriteActionResult(const std::string &key,
+                         const remote_cache::ActionResult &result) const;
+
+private:
+  std::filesystem::path root_;
+};
+
+// Who may use the services. Without a token anyone that can reach the server
+// may, so it should only listen on a trusted network.
+struct CacheAccess {
+  // If set, every call must carry `authorization: Bearer <token>`.
+  std::string token;
+  // Rejects uploads (BatchUpdateBlobs and UpdateActionResult), e.g. for a
+  // server that untrusted clients read the results of a CI from.
+  bool read_only = false;
+
+  // OK if `context` may make a call, which uploads if `write`.
+  grpc::Status Check(const grpc::ServerContext &context, bool write) const;
+};
+
+// Hashes and keys are lowercase hex SHA-256, they end up in file names so
+// nothing else may be accepted.
+bool IsValidHash(std::string_view hash);
+
+class CasService final
+    : public remote_cache::ContentAddressableStorage::Service {
+public:
+  CasService(const DiskStore *store, CacheAccess access)
+      : store_(store), access_(std::move(access)) {}
+
+  grpc::Status
+  FindMissingBlobs(grpc::ServerContext *context,
+                   const remote_cache::FindMissingBlobsRequest *request,
+                   remote_cache::FindMissingBlobsResponse *response) override;
+  grpc::Status
+  BatchUpdateBlobs(grpc::ServerContext *context,
+                   const remote_cache::BatchUpdateBlobsRequest *request,
+                   remote_cache::BatchUpdateBlobsResponse *response) override;
+  grpc::Status
+  BatchReadBlobs(grpc::ServerContext *context,
+                 const remote_cache::BatchReadBlobsRequest *request,
+                 remote_cache::BatchReadBlobsResponse *response) override;
+
+private:
+  const DiskStore *store_;
+  CacheAccess access_;
+};
+
+class ActionCacheService final : public remote_cache::ActionCache::Service {
+public:
+  ActionCacheService(const DiskStore *store, CacheAccess access)
+      : store_(store), access_(std::move(access)) {}
+
+  grpc::Status
+  GetActionResult(grpc::ServerContext *context,
+                  const remote_cache::GetActionResultRequest *request,
+                  remote_cache::ActionResult *response) override;
+  grpc::Status
+  UpdateActionResult(grpc::ServerContext *context,
+                     const remote_cache::UpdateActionResultRequest *request,
+                     remote_cache::ActionResult *response) override;
+
+private:
+  const DiskStore *store_;
+  CacheAccess access_;
+};
+
+} // namespace myproject
@@ -0,0 +1,50 @@
+#include "service/credentials.h"
+
+#include <cctype>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "sandbox/cache.h"
+
+namespace myproject {
+
+std::string ReadToken(const std::filesystem::path &path) {
+  auto token = sandbox::ReadFile(path);
+  while (!token.empty() &&
+         std::isspace(static_cast<unsigned char>(token.back()))) {
+    token.pop_back();
+  }
+  if (token.empty()) {
+    throw std::runtime_error(fmt::format("no token in {}", path.native()));
+  }
+  return token;
+}
+
+std::shared_ptr<grpc::ServerCredentials>
+MakeServerCredentials(const std::filesystem::path &cert,
+                      const std::filesystem::path &key) {
+  if (cert.empty() && key.empty()) {
+    return grpc::InsecureServerCredentials();
+  }
+  if (cert.empty() || key.empty()) {
+    throw std::runtime_error("TLS needs both a certificate and a key");
+  }
+  grpc::SslServerCredentialsOptions options;
+  options.pem_key_cert_pairs.push_back(
+      {.private_key = sandbox::ReadFile(key),
+       .cert_chain = sandbox::ReadFile(cert)});
+  return grpc::SslServerCredentials(options);
+}
+
+std::shared_ptr<grpc::ChannelCredentials>
+MakeChannelCredentials(const std::filesystem::path &ca) {
+  if (ca.empty()) {
+    return grpc::InsecureChannelCredentials();
+  }
+  grpc::SslCredentialsOptions options;
+  options.pem_root_certs = sandbox::ReadFile(ca);
+  return grpc::SslCredentials(options);
+}
+
+} // namespace myproject
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include <grpcpp/grpcpp.h>
+
+namespace myproject {
+
+// Reads a bearer token from `path`, without the trailing whitespace. Throws
+// if the file can't be read or is empty.
+std::string ReadToken(const std::filesystem::path &path);
+
+// TLS credentials with the PEM certificate chain in `cert` and its key in
+// `key`, plaintext if both are empty. Throws if a file can't be read.
+std::shared_ptr<grpc::ServerCredentials>
+MakeServerCredentials(const std::filesystem::path &cert,
+                      const std::filesystem::path &key);
+
+// TLS credentials trusting the PEM root certificates in `ca`, plaintext if
+// it is empty. Throws if it can't be read.
+std::shared_ptr<grpc::ChannelCredentials>
+MakeChannelCredentials(const std::filesystem::path &ca);
+
+} // namespace myproject
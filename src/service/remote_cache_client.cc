@@ -0,0 +1,164 @@
+#include "service/remote_cache_client.h"
+
+#include <chrono>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include <fmt/format.h>
+#include <grpcpp/grpcpp.h>
+
+#include "sandbox/sha256.h"
+#include "service/credentials.h"
+#include "service/rpc_limits.h"
+
+namespace myproject {
+namespace {
+
+// A cache that is slower than compiling is no use, give up early.
+constexpr auto kTimeout = std::chrono::seconds(10);
+
+std::runtime_error RpcError(std::string_view method,
+                            const grpc::Status &status) {
+  return std::runtime_error(
+      fmt::format("{} failed: {}", method, status.error_message()));
+}
+
+remote_cache::Digest MakeDigest(std::string_view data) {
+  sandbox::Sha256 hash;
+  hash.Update(data);
+  remote_cache::Digest digest;
+  digest.set_hash(hash.HexDigest());
+  digest.set_size_bytes(data.size());
+  return digest;
+}
+
+} // namespace
+
+RemoteCache::RemoteCache(const std::string &address,
+                         const std::filesystem::path &token_file,
+                         const std::filesystem::path &ca_file) {
+  if (!token_file.empty()) {
+    authorization_ = "Bearer " + ReadToken(token_file);
+  }
+  grpc::ChannelArguments args;
+  args.SetMaxReceiveMessageSize(kMaxMessageSize);
+  args.SetMaxSendMessageSize(kMaxMessageSize);
+  auto channel = grpc::CreateCustomChannel(
+      address, MakeChannelCredentials(ca_file), args);
+  cas_ = remote_cache::ContentAddressableStorage::NewStub(channel);
+  action_cache_ = remote_cache::ActionCache::NewStub(channel);
+}
+
+void RemoteCache::Prepare(grpc::ClientContext *context) const {
+  context->set_deadline(std::chrono::system_clock::now() + kTimeout);
+  if (!authorization_.empty()) {
+    context->AddMetadata("authorization", authorization_);
+  }
+}
+
+bool RemoteCache::Restore(const sandbox::CacheAction &action) {
+  remote_cache::ActionResult result;
+  {
+    grpc::ClientContext context;
+    Prepare(&context);
+    remote_cache::GetActionResultRequest request;
+    request.set_action_key(action.key);
+    auto status = action_cache_->GetActionResult(&context, request, &result);
+    if (status.error_code() == grpc::StatusCode::NOT_FOUND) {
+      return false;
+    }
+    if (!status.ok()) {
+      throw RpcError("GetActionResult", status);
+    }
+  }
+  // Only ever write the outputs of this action, whatever the server says.
+  if (result.output_files_size() != static_cast<int>(action.outputs.size())) {
+    return false;
+  }
+  remote_cache::BatchReadBlobsRequest request;
+  for (int i = 0; i < result.output_files_size(); ++i) {
+    if (result.output_files(i).path() != action.outputs[i].native()) {
+      return false;
+    }
+    *request.add_digests() = result.output_files(i).digest();
+  }
+  remote_cache::BatchReadBlobsResponse response;
+  grpc::ClientContext context;
+  Prepare(&context);
+  auto status = cas_->BatchReadBlobs(&context, request, &response);
+  if (!status.ok()) {
+    throw RpcError("BatchReadBlobs", status);
+  }
+  std::map<std::string, const std::string *> blobs;
+  for (const auto &blob : response.responses()) {
+    if (MakeDigest(blob.data()).hash() == blob.digest().hash()) {
+      blobs.emplace(blob.digest().hash(), &blob.data());
+    }
+  }
+  for (const auto &output : result.output_files()) {
+    if (!blobs.contains(output.digest().hash())) {
+      return false;
+    }
+  }
+  for (int i = 0; i < result.output_files_size(); ++i) {
+    sandbox::WriteFileAtomic(action.outputs[i],
+                             *blobs.at(result.output_files(i).digest().hash()));
+  }
+  return true;
+}
+
+void RemoteCache::Store(const sandbox::CacheAction &action) {
+  std::vector<std::string> contents;
+  remote_cache::UpdateActionResultRequest update;
+  update.set_action_key(action.key);
+  remote_cache::FindMissingBlobsRequest find;
+  for (const auto &output : action.outputs) {
+    contents.push_back(sandbox::ReadFile(output));
+    auto *file = update.mutable_action_result()->add_output_files();
+    file->set_path(output.native());
+    *file->mutable_digest() = MakeDigest(contents.back());
+    *find.add_blob_digests() = file->digest();
+  }
+
+  remote_cache::FindMissingBlobsResponse missing;
+  {
+    grpc::ClientContext context;
+    Prepare(&context);
+    auto status = cas_->FindMissingBlobs(&context, find, &missing);
+    if (!status.ok()) {
+      throw RpcError("FindMissingBlobs", status);
+    }
+  }
+  if (missing.missing_blob_digests_size() > 0) {
+    remote_cache::BatchUpdateBlobsRequest upload;
+    for (const auto &digest : missing.missing_blob_digests()) {
+      for (size_t i = 0; i < contents.size(); ++i) {
+        const auto &file = update.action_result().output_files(i);
+        if (file.digest().hash() == digest.hash()) {
+          auto *blob = upload.add_requests();
+          *blob->mutable_digest() = digest;
+          blob->set_data(contents[i]);
+          break;
+        }
+      }
+    }
+    remote_cache::BatchUpdateBlobsResponse uploaded;
+    grpc::ClientContext context;
+    Prepare(&context);
+    auto status = cas_->BatchUpdateBlobs(&context, upload, &uploaded);
+    if (!status.ok()) {
+      throw RpcError("BatchUpdateBlobs", status);
+    }
+  }
+
+  remote_cache::ActionResult stored;
+  grpc::ClientContext context;
+  Prepare(&context);
+  auto status = action_cache_->UpdateActionResult(&context, update, &stored);
+  if (!status.ok()) {
+    throw RpcError("UpdateActionResult", status);
+  }
+}
+
+} // namespace myproject
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "sandbox/cache.h"
+#include "service/remote_cache.grpc.pb.h"
+
+namespace myproject {
+
+// The --remote_cache backend of remote_process_wrapper, talks to a
+// cache_server.
+class RemoteCache final : public sandbox::CacheBackend {
+public:
+  // Sends the token in `token_file` with every call if it is set, and talks
+  // TLS trusting the root certificates in `ca_file` if that is. Throws if
+  // either can't be read.
+  RemoteCache(const std::string &address,
+              const std::filesystem::path &token_file = {},
+              const std::filesystem::path &ca_file = {});
+
+  // Throws if the server can't be reached, the caller then runs the action
+  // locally.
+  bool Restore(const sandbox::CacheAction &action) override;
+  void Store(const sandbox::CacheAction &action) override;
+
+private:
+  // Sets the deadline and credentials of a call.
+  void Prepare(grpc::ClientContext *context) const;
+
+  std::string authorization_;
+  std::unique_ptr<remote_cache::ContentAddressableStorage::Stub> cas_;
+  std::unique_ptr<remote_cache::ActionCache::Stub> action_cache_;
+};
+
+} // namespace myproject
@@ -0,0 +1,18 @@
+#include <memory>
+#include <string>
+
+#include "sandbox/run.h"
+#include "service/remote_cache_client.h"
+
+// The sandbox process wrapper with --remote_cache support, see
+// remote_cache.proto.
+int main(int argc, char **argv) {
+  return sandbox::WrapperMain(
+      argc, argv,
+      [](const sandbox::ParsedArgs &parsed)
+          -> std::unique_ptr<sandbox::CacheBackend> {
+        return std::make_unique<myproject::RemoteCache>(
+            parsed.remote_cache, parsed.remote_cache_token,
+            parsed.remote_cache_ca);
+      });
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+namespace myproject {
+
+// Object files of large translation units with debug info easily exceed the
+// 4 MiB default of gRPC, and the blobs are sent in a single batch.
+inline constexpr int kMaxMessageSize = 256 * 1024 * 1024;
+
+} // namespace myproject
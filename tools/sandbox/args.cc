@@ -0,0 +1,261 @@
+#include "sandbox/args.h"
+
+#include <charconv>
+#include <cstdlib>
+#include <stdexcept>
+#include <string_view>
+
+#include <absl/strings/str_split.h>
+#include <absl/strings/strip.h>
+#include <fmt/format.h>
+
+namespace sandbox {
+namespace {
+
+void ParsePathArg(std::string_view arg, std::span<std::string> *rest,
+                  ParsedArgs *parsed) {
+  auto original_arg = arg;
+  if (!absl::ConsumePrefix(&arg, "--")) {
+    throw std::runtime_error(
+        fmt::format("invalid argument: \"{}\"", original_arg));
+  }
+  bool rw = arg.starts_with("rw");
+  if (!absl::ConsumePrefix(&arg, "ro") && !absl::ConsumePrefix(&arg, "rw")) {
+    throw std::runtime_error(
+        fmt::format("invalid argument: \"{}\"", original_arg));
+  }
+  if (!absl::ConsumePrefix(&arg, "_")) {
+    throw std::runtime_error(
+        fmt::format("invalid argument: \"{}\"", original_arg));
+  }
+  bool dirs = arg.starts_with("dirs");
+  if (!absl::ConsumePrefix(&arg, "paths") &&
+      !absl::ConsumePrefix(&arg, "dirs")) {
+    throw std::runtime_error(
+        fmt::format("invalid argument: \"{}\"", original_arg));
+  }
+  if (!absl::ConsumePrefix(&arg, "=")) {
+    if (!arg.empty()) {
+      throw std::runtime_error(
+          fmt::format("invalid argument: \"{}\"", original_arg));
+    }
+    if (rest->empty()) {
+      throw std::runtime_error(
+          fmt::format("missing value for: \"{}\"", original_arg));
+    }
+    arg = rest->front();
+    *rest = rest->subspan(1);
+  }
+  if (arg.empty()) {
+    throw std::runtime_error(
+        fmt::format("missing value for: \"{}\"", original_arg));
+  }
+  std::vector<std::string> splits = absl::StrSplit(arg, ":");
+  std::vector<std::filesystem::path> *pathnames;
+  if (dirs) {
+    pathnames = rw ? &parsed->rw_dirs : &parsed->ro_dirs;
+  } else {
+    pathnames = rw ? &parsed->rw_paths : &parsed->ro_paths;
+  }
+  for (const auto &split : splits) {
+    pathnames->emplace_back(split);
+  }
+}
+
+// Parses `--<name>=<value>` or `--<name> <value>`, returning false if `arg` is
+// a different flag.
+bool ParseValueArg(std::string_view arg, std::string_view name,
+                   std::span<std::string> *rest, std::string *value) {
+  auto original_arg = arg;
+  if (!absl::ConsumePrefix(&arg, "--") || !absl::ConsumePrefix(&arg, name)) {
+    return false;
+  }
+  if (!absl::ConsumePrefix(&arg, "=")) {
+    if (!arg.empty()) {
+      return false;
+    }
+    if (rest->empty()) {
+      throw std::runtime_error(
+          fmt::format("missing value for: \"{}\"", original_arg));
+    }
+    arg = rest->front();
+    *rest = rest->subspan(1);
+  }
+  if (arg.empty()) {
+    throw std::runtime_error(
+        fmt::format("missing value for: \"{}\"", original_arg));
+  }
+  *value = arg;
+  return true;
+}
+
+int ParseIntArg(std::string_view name, std::string_view value) {
+  int result = 0;
+  auto [end, ec] =
+      std::from_chars(value.data(), value.data() + value.size(), result);
+  if (ec != std::errc() || end != value.data() + value.size()) {
+    throw std::runtime_error(
+        fmt::format("invalid value for --{}: \"{}\"", name, value));
+  }
+  return result;
+}
+
+} // namespace
+
+std::vector<std::string> MakeArgs(int argc, char **argv) {
+  std::vector<std::string> args;
+  args.reserve(argc);
+  for (int i = 1; i < argc; ++i) {
+    args.emplace_back(argv[i]);
+  }
+  return args;
+}
+
+ParsedArgs ParseCommandLine(std::span<std::string> args) {
+  ParsedArgs parsed;
+  while (!args.empty()) {
+    auto arg = args.front();
+    args = args.subspan(1);
+    if (arg == "--") {
+      parsed.remainder = args;
+      return parsed;
+    }
+    if (arg == "--debug") {
+      parsed.debug = true;
+      continue;
+    }
+    if (arg == "--deny_network") {
+      parsed.deny_network = true;
+      continue;
+    }
+    if (arg == "--audit") {
+      parsed.audit = true;
+      continue;
+    }
+    if (arg == "--private_tmp") {
+      parsed.private_tmp = true;
+      continue;
+    }
+    if (arg == "--capture_output") {
+      parsed.capture_output = true;
+      continue;
+    }
+    std::string value;
+    if (ParseValueArg(arg, "policy", &args, &value)) {
+      parsed.policy = value;
+      continue;
+    }
+    if (ParseValueArg(arg, "fork_server", &args, &value)) {
+      parsed.fork_server = value;
+      continue;
+    }
+    if (ParseValueArg(arg, "idle_timeout", &args, &value)) {
+      parsed.idle_timeout = ParseIntArg("idle_timeout", value);
+      continue;
+    }
+    if (ParseValueArg(arg, "cache_dir", &args, &value)) {
+      parsed.cache_dir = value;
+      continue;
+    }
+    if (ParseValueArg(arg, "remote_cache", &args, &value)) {
+      parsed.remote_cache = value;
+      continue;
+    }
+    if (ParseValueArg(arg, "remote_cache_token", &args, &value)) {
+      parsed.remote_cache_token = value;
+      continue;
+    }
+    if (ParseValueArg(arg, "remote_cache_ca", &args, &value)) {
+      parsed.remote_cache_ca = value;
+      continue;
+    }
+    if (ParseValueArg(arg, "stats", &args, &value)) {
+      parsed.stats = value;
+      continue;
+    }
+    if (ParseValueArg(arg, "output_log", &args, &value)) {
+      parsed.output_log = value;
+      continue;
+    }
+    if (ParseValueArg(arg, "label", &args, &value)) {
+      parsed.label = value;
+      continue;
+    }
+    if (ParseValueArg(arg, "connect", &args, &value)) {
+      // Only used by the fork server client, if we got here the server was
+      // not reachable and the program is run directly.
+      continue;
+    }
+    if (arg == "--help") {
+      fmt::println(stderr, "A Sandbox process wrapper program, usage:\n"
+                           "./process_wrapper --ro_dirs a:b:c "
+                           "--rw_paths=/tmp:/usr/tmp -- ./my_program <args>\n\n"
+                           "Available flags:\n"
+                           "\t--ro_dirs \n\t\ta colon delimited list of "
+                           "readonly directory trees\n"
+                           "\t--rw_dirs \n\t\ta colon delimited list of "
+                           "readwrite directory trees\n"
+                           "\t--ro_paths \n\t\ta colon delimited list of "
+                           "readonly directories and files\n"
+                           "\t--rw_paths \n\t\ta colon delimited list of "
+                           "readwrite directories and files\n"
+                           "\t--policy \n\t\ta policy file compiled by "
+                           "policy_compiler, adds its rules to the ones "
+                           "above\n"
+                           "\t--cache_dir \n\t\ta directory to cache "
+                           "compiler outputs in, keyed by the contents of "
+                           "the readonly files\n"
+                           "\t--remote_cache \n\t\tthe address of a "
+                           "remote cache service to look up compiles in "
+                           "before running them\n"
+                           "\t--remote_cache_token \n\t\ta file with "
+                           "the token of the remote cache\n"
+                           "\t--remote_cache_ca \n\t\tthe PEM root "
+                           "certificates to talk TLS to the remote cache "
+                           "with\n"
+                           "\t--stats \n\t\ta file to append a JSON line "
+                           "with sandbox timings and the resource usage of "
+                           "the program to\n"
+                           "\t--label \n\t\ta name for the program in "
+                           "the stats, e.g. its target\n"
+                           "\t--deny_network \n\t\tdon't let the program "
+                           "bind or connect TCP sockets (Landlock ABI 4), "
+                           "only such programs use --remote_cache\n"
+                           "\t--private_tmp \n\t\tgive the program a new "
+                           "directory below $TMPDIR as its TMPDIR, and "
+                           "only that instead of /tmp, removed when it "
+                           "exits\n"
+                           "\t--capture_output \n\t\tbuffer the "
+                           "program's stdout and stderr, print a one line "
+                           "summary if it succeeded and the output if it "
+                           "failed\n"
+                           "\t--output_log \n\t\twith --capture_output, "
+                           "append the output of failed programs to this "
+                           "file as zstd frames and only print its first "
+                           "lines\n"
+                           "\t--audit \n\t\trun without the sandbox and "
+                           "write the files a compile read, and if the "
+                           "sandbox allows them, to <object>.inputs\n"
+                           "\t--connect \n\t\tthe socket of a fork server "
+                           "to run the program on, falls back to running "
+                           "it directly if no server is listening\n"
+                           "\t--fork_server \n\t\trun as a fork server "
+                           "listening on this socket, does not take a "
+                           "program\n"
+                           "\t--idle_timeout \n\t\tseconds a fork server "
+                           "may be idle before exiting (default: never)\n\n"
+                           "NOTE: All path flags above refer to a path and "
+                           "*all* paths below it - rules are applied "
+                           "recursively");
+      std::exit(0);
+    }
+    ParsePathArg(arg, &args, &parsed);
+  }
+  if (!parsed.fork_server.empty()) {
+    return parsed;
+  }
+  throw std::runtime_error("invalid arguments, there must be a -- between "
+                           "sandbox args and the actual program");
+}
+
+} // namespace sandbox
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace sandbox {
+
+struct ParsedArgs {
+  std::vector<std::filesystem::path> rw_paths;
+  std::vector<std::filesystem::path> ro_paths;
+  std::vector<std::filesystem::path> rw_dirs;
+  std::vector<std::filesystem::path> ro_dirs;
+  // A precompiled policy with more rules, see policy.h
+  std::filesystem::path policy;
+  std::span<std::string> remainder;
+  bool debug = false;
+  // When set, run as a fork server listening on this socket instead of
+  // wrapping a single program.
+  std::filesystem::path fork_server;
+  // Seconds a fork server waits without any clients before exiting, 0 means
+  // run forever.
+  int idle_timeout = 0;
+  // Serve compiles from a content-addressed cache in this directory, see
+  // cache.h
+  std::filesystem::path cache_dir;
+  // Address of a remote cache service to share the cache with, only
+  // supported by wrappers built with a RemoteCacheFactory (see run.h).
+  std::string remote_cache;
+  // A file with the token the remote cache wants, sent as a bearer token.
+  std::filesystem::path remote_cache_token;
+  // Talk TLS to the remote cache, trusting the PEM root certificates in this
+  // file.
+  std::filesystem::path remote_cache_ca;
+  // Append a JSON line with timings and resource usage of the program to
+  // this file, see stats.h
+  std::filesystem::path stats;
+  // Names the action in the stats, e.g. the target it belongs to.
+  std::string label;
+  // Also keep the program off the network (TCP bind and connect), on kernels
+  // that support it. Only such programs count as hermetic, see Run()
+  bool deny_network = false;
+  // Give the program a new directory as TMPDIR, removed again when it exits,
+  // instead of the shared /tmp. See Run()
+  bool private_tmp = false;
+  // Capture the program's stdout and stderr instead of passing them through,
+  // and only show them if it failed, see capture.h
+  bool capture_output = false;
+  // With --capture_output, append the output of failed programs to this
+  // file zstd compressed, and only show its first lines.
+  std::filesystem::path output_log;
+  // Run without the sandbox, and record which files a compile read instead,
+  // see audit.h
+  bool audit = false;
+};
+
+// Copies argv (without the program name) into owned strings.
+std::vector<std::string> MakeArgs(int argc, char **argv);
+
+// Parses the sandbox flags, everything after `--` is left in `remainder`.
+//
+// Throws std::runtime_error for malformed arguments.
+ParsedArgs ParseCommandLine(std::span<std::string> args);
+
+} // namespace sandbox
@@ -0,0 +1,184 @@
+#include "sandbox/audit.h"
+
+#include <set>
+#include <stdexcept>
+#include <system_error>
+#include <unordered_set>
+
+#include <absl/strings/strip.h>
+#include <fmt/format.h>
+
+#include "sandbox/cache.h"
+#include "sandbox/landlock.h"
+#include "sandbox/policy.h"
+#include "sandbox/sandbox.h"
+
+namespace sandbox {
+namespace {
+
+namespace fs = std::filesystem;
+
+fs::path Canonical(const fs::path &path) {
+  std::error_code ec;
+  auto canonical = fs::weakly_canonical(fs::absolute(path), ec);
+  if (ec) {
+    return fs::absolute(path).lexically_normal();
+  }
+  return canonical;
+}
+
+// The value of `flag` in `args`, given as `<flag> <value>` or
+// `<flag><value>`, empty if it is missing.
+std::string FlagValue(std::span<const std::string> args,
+                      std::string_view flag) {
+  for (size_t i = 1; i < args.size(); ++i) {
+    std::string_view arg = args[i];
+    if (!absl::ConsumePrefix(&arg, flag)) {
+      continue;
+    }
+    if (!arg.empty()) {
+      return std::string(arg);
+    }
+    if (i + 1 < args.size()) {
+      return args[i + 1];
+    }
+  }
+  return "";
+}
+
+// The paths under which the sandbox lets the program read files.
+class ReadableSet {
+public:
+  void Add(const fs::path &path, landlock::FSAccess access) {
+    if ((access & landlock::FSAccess::READ_FILE).Value()) {
+      paths_.insert(Canonical(path));
+    }
+  }
+
+  bool Contains(const fs::path &path) const {
+    for (auto p = path;; p = p.parent_path()) {
+      if (paths_.contains(p)) {
+        return true;
+      }
+      if (p == p.root_path() || p.empty()) {
+        return false;
+      }
+    }
+  }
+
+private:
+  std::set<fs::path> paths_;
+};
+
+} // namespace
+
+std::vector<std::string> ParseDepfile(std::string_view contents) {
+  std::vector<std::string> inputs;
+  std::unordered_set<std::string> seen;
+  std::string token;
+  // Targets come before the colon of a rule, the prerequisites after it.
+  bool in_targets = true;
+  auto flush = [&] {
+    if (!token.empty() && !in_targets && seen.insert(token).second) {
+      inputs.push_back(token);
+    }
+    token.clear();
+  };
+  for (size_t i = 0; i < contents.size(); ++i) {
+    char c = contents[i];
+    char next = i + 1 < contents.size() ? contents[i + 1] : '\n';
+    if (c == '\\') {
+      if (next == '\n') {
+        flush();
+        ++i;
+      } else if (next == '\r' && i + 2 < contents.size() &&
+                 contents[i + 2] == '\n') {
+        flush();
+        i += 2;
+      } else if (next == ' ' || next == '#') {
+        token += next;
+        ++i;
+      } else {
+        token += c;
+      }
+    } else if (c == '$' && next == '$') {
+      token += '$';
+      ++i;
+    } else if (c == ':' && in_targets &&
+               (next == ' ' || next == '\t' || next == '\r' || next == '\n')) {
+      token.clear();
+      in_targets = false;
+    } else if (c == '\n') {
+      flush();
+      in_targets = true;
+    } else if (c == ' ' || c == '\t' || c == '\r') {
+      flush();
+    } else {
+      token += c;
+    }
+  }
+  flush();
+  return inputs;
+}
+
+std::vector<AuditedInput> AuditInputs(const ParsedArgs &parsed,
+                                      std::span<const std::string> inputs) {
+  ReadableSet readable;
+  for (const auto &entry : AutomaticEntries(!parsed.private_tmp)) {
+    readable.Add(entry.path, entry.access);
+  }
+  for (const auto &p : parsed.ro_dirs) {
+    readable.Add(p,
+                 landlock::FSAccess::kAllDir & landlock::FSAccess::kReadonly);
+  }
+  for (const auto &p : parsed.rw_dirs) {
+    readable.Add(p, landlock::FSAccess::kAllDir);
+  }
+  for (const auto &p : parsed.ro_paths) {
+    readable.Add(p, landlock::FSAccess::kReadonly);
+  }
+  for (const auto &p : parsed.rw_paths) {
+    readable.Add(p, landlock::FSAccess::kAllDir | landlock::FSAccess::kAllFile);
+  }
+  if (!parsed.policy.empty()) {
+    auto policy = Policy::Map(parsed.policy);
+    for (const auto &rule : policy.Rules()) {
+      readable.Add(policy.Path(rule), rule.access);
+    }
+  }
+
+  std::vector<AuditedInput> audited;
+  audited.reserve(inputs.size());
+  for (const auto &input : inputs) {
+    auto path = Canonical(input);
+    bool allowed = readable.Contains(path);
+    audited.push_back({.path = std::move(path), .allowed = allowed});
+  }
+  return audited;
+}
+
+void WriteAuditManifest(const ParsedArgs &parsed) {
+  auto object = FlagValue(parsed.remainder, "-o");
+  auto depfile = FlagValue(parsed.remainder, "-MF");
+  if (object.empty() || depfile.empty()) {
+    return;
+  }
+  auto inputs = ParseDepfile(ReadFile(depfile));
+  std::string manifest;
+  int denied = 0;
+  for (const auto &input : AuditInputs(parsed, inputs)) {
+    denied += !input.allowed;
+    manifest += fmt::format("{} {}\n", input.allowed ? "allowed" : "denied",
+                            input.path.native());
+  }
+  auto manifest_path = object + ".inputs";
+  WriteFileAtomic(manifest_path, manifest);
+  if (denied) {
+    fmt::println(stderr,
+                 "sandbox audit: {} read {} files outside of its sandbox, see "
+                 "{}",
+                 object, denied, manifest_path);
+  }
+}
+
+} // namespace sandbox
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sandbox/args.h"
+
+namespace sandbox {
+
+// Audit mode (--audit): the program runs without the sandbox, and the files a
+// compile read, as listed in its depfile, are checked against the rules it
+// would have been given. The results are written to a manifest next to the
+// object file, `<object>.inputs`, with one line per input:
+//
+//   allowed /abs/path/of/a/declared/header.h
+//   denied /abs/path/of/a/header/outside/the/policy.h
+//
+// sandbox_audit_report turns the manifests of a build into the DEPS each
+// target actually uses, see cmake/rules.cmake.
+
+// The prerequisites of every rule in a Makefile style depfile, as written by
+// -MD/-MMD, in order and without duplicates.
+std::vector<std::string> ParseDepfile(std::string_view contents);
+
+struct AuditedInput {
+  // Absolute and normalized.
+  std::filesystem::path path;
+  // If the sandbox would have let the program read the file.
+  bool allowed;
+};
+
+// Checks `inputs` (relative to the working directory) against the rules in
+// `parsed` and the automatic paths.
+std::vector<AuditedInput> AuditInputs(const ParsedArgs &parsed,
+                                      std::span<const std::string> inputs);
+
+// Writes the manifest for the compile in `parsed.remainder` after it ran
+// with --audit, and warns about the inputs the sandbox would have denied.
+// Programs that are not compiles with an `-o` and a `-MF` are skipped.
+//
+// Throws if the depfile can't be read or the manifest can't be written.
+void WriteAuditManifest(const ParsedArgs &parsed);
+
+} // namespace sandbox
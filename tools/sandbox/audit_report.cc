@@ -0,0 +1,225 @@
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <absl/strings/str_split.h>
+#include <absl/strings/strip.h>
+#include <fmt/format.h>
+
+#include "sandbox/cache.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr std::string_view kUsage =
+    "Turns the --audit manifests of a build into the DEPS every target uses, "
+    "usage:\n"
+    "./audit_report <targets.txt> <output.cmake>\n\n"
+    "The targets are written by cmake/rules.cmake, one record per line:\n"
+    "  target <name> <display name> <object directory or ->\n"
+    "  header <name> <public header>\n"
+    "  dep <name> <DEPS entry> <target it names or ->\n"
+    "Every <object>.inputs below the object directory of a target counts as\n"
+    "read by it. A DEPS entry is used if a compile read a public header of it\n"
+    "or of anything it depends on. Entries that are not landlock targets\n"
+    "(e.g. third party packages) can't be judged and are kept.\n\n"
+    "For every audited target the output sets LANDLOCK_AUDIT_DEPS_<name> to\n"
+    "the used DEPS, LANDLOCK_AUDIT_UNUSED_<name> to the rest, and\n"
+    "LANDLOCK_AUDIT_UNDECLARED_<name> to the targets whose headers it read\n"
+    "without depending on them.";
+
+struct Dep {
+  std::string spelling;
+  std::string target;
+};
+
+struct Target {
+  std::string display_name;
+  fs::path object_dir;
+  std::vector<fs::path> headers;
+  std::vector<Dep> deps;
+};
+
+fs::path Canonical(const fs::path &path) {
+  std::error_code ec;
+  auto canonical = fs::weakly_canonical(path, ec);
+  return ec ? path.lexically_normal() : canonical;
+}
+
+std::map<std::string, Target> ReadTargets(const fs::path &path) {
+  std::map<std::string, Target> targets;
+  int line_number = 0;
+  for (std::string_view line :
+       absl::StrSplit(sandbox::ReadFile(path), '\n', absl::SkipEmpty())) {
+    ++line_number;
+    std::vector<std::string_view> fields =
+        absl::StrSplit(line, absl::MaxSplits(' ', 2));
+    if (fields.size() != 3) {
+      throw std::runtime_error(
+          fmt::format("{}:{}: malformed line", path.native(), line_number));
+    }
+    auto &target = targets[std::string(fields[1])];
+    std::pair<std::string, std::string> rest =
+        absl::StrSplit(fields[2], absl::MaxSplits(' ', 1));
+    if (fields[0] == "target") {
+      target.display_name = rest.first;
+      if (rest.second != "-") {
+        target.object_dir = rest.second;
+      }
+    } else if (fields[0] == "header") {
+      target.headers.push_back(Canonical(fields[2]));
+    } else if (fields[0] == "dep") {
+      target.deps.push_back(
+          {.spelling = rest.first,
+           .target = rest.second == "-" ? "" : rest.second});
+    } else {
+      throw std::runtime_error(fmt::format("{}:{}: unknown record \"{}\"",
+                                           path.native(), line_number,
+                                           fields[0]));
+    }
+  }
+  return targets;
+}
+
+// A target and everything it depends on, memoized.
+class Closures {
+public:
+  explicit Closures(const std::map<std::string, Target> &targets)
+      : targets_(targets) {}
+
+  const std::set<std::string> &Get(const std::string &name) {
+    if (auto it = closures_.find(name); it != closures_.end()) {
+      return it->second;
+    }
+    // Inserted first, so cycles end here.
+    auto &closure = closures_[name];
+    std::set<std::string> result = {name};
+    if (auto it = targets_.find(name); it != targets_.end()) {
+      for (const auto &dep : it->second.deps) {
+        if (!dep.target.empty()) {
+          const auto &dep_closure = Get(dep.target);
+          result.insert(dep_closure.begin(), dep_closure.end());
+        }
+      }
+    }
+    closure = std::move(result);
+    return closure;
+  }
+
+private:
+  const std::map<std::string, Target> &targets_;
+  std::map<std::string, std::set<std::string>> closures_;
+};
+
+// The targets owning the headers read by the compiles of `target`, nullopt if
+// none of them was audited.
+std::optional<std::set<std::string>>
+ReadOwners(const Target &target,
+           const std::map<fs::path, std::string> &owners) {
+  std::error_code ec;
+  if (target.object_dir.empty() || !fs::is_directory(target.object_dir, ec)) {
+    return std::nullopt;
+  }
+  std::optional<std::set<std::string>> read;
+  for (const auto &entry :
+       fs::recursive_directory_iterator(target.object_dir)) {
+    if (!entry.is_regular_file() || entry.path().extension() != ".inputs") {
+      continue;
+    }
+    if (!read) {
+      read.emplace();
+    }
+    for (std::string_view line : absl::StrSplit(
+             sandbox::ReadFile(entry.path()), '\n', absl::SkipEmpty())) {
+      if (!absl::ConsumePrefix(&line, "allowed ")) {
+        absl::ConsumePrefix(&line, "denied ");
+      }
+      if (auto it = owners.find(fs::path(line)); it != owners.end()) {
+        read->insert(it->second);
+      }
+    }
+  }
+  return read;
+}
+
+std::string CMakeList(const std::vector<std::string> &items) {
+  return fmt::format("\"{}\"", fmt::join(items, ";"));
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fmt::println(stderr, "{}", kUsage);
+    return 1;
+  }
+  try {
+    auto targets = ReadTargets(argv[1]);
+    std::map<fs::path, std::string> owners;
+    for (const auto &[name, target] : targets) {
+      for (const auto &header : target.headers) {
+        owners.emplace(header, name);
+      }
+    }
+    Closures closures(targets);
+
+    std::string output =
+        "# Generated by sandbox_audit_report from the --audit manifests of a "
+        "build.\n";
+    std::vector<std::string> audited;
+    for (const auto &[name, target] : targets) {
+      auto read = ReadOwners(target, owners);
+      if (!read) {
+        continue;
+      }
+      read->erase(name);
+      std::vector<std::string> used, unused, undeclared;
+      std::set<std::string> reachable;
+      for (const auto &dep : target.deps) {
+        auto it = targets.find(dep.target);
+        if (dep.target.empty() || it == targets.end()) {
+          used.push_back(dep.spelling);
+          continue;
+        }
+        const auto &closure = closures.Get(dep.target);
+        reachable.insert(closure.begin(), closure.end());
+        bool has_headers = false, is_used = false;
+        for (const auto &owner : closure) {
+          auto owner_it = targets.find(owner);
+          has_headers = has_headers || (owner_it != targets.end() &&
+                                        !owner_it->second.headers.empty());
+          is_used = is_used || read->contains(owner);
+        }
+        (is_used || !has_headers ? used : unused).push_back(dep.spelling);
+      }
+      for (const auto &owner : *read) {
+        if (!reachable.contains(owner)) {
+          undeclared.push_back(targets.at(owner).display_name);
+        }
+      }
+      audited.push_back(name);
+      output += fmt::format("set(LANDLOCK_AUDIT_DEPS_{} {})\n", name,
+                            CMakeList(used));
+      output += fmt::format("set(LANDLOCK_AUDIT_UNUSED_{} {})\n", name,
+                            CMakeList(unused));
+      output += fmt::format("set(LANDLOCK_AUDIT_UNDECLARED_{} {})\n", name,
+                            CMakeList(undeclared));
+    }
+    output +=
+        fmt::format("set(LANDLOCK_AUDIT_TARGETS {})\n", CMakeList(audited));
+    sandbox::WriteFileAtomic(argv[2], output);
+  } catch (const std::exception &ex) {
+    fmt::println(stderr, "{}", ex.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,427 @@
+#include "sandbox/cache.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <set>
+#include <string_view>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+#include <absl/cleanup/cleanup.h>
+#include <absl/strings/match.h>
+#include <absl/strings/str_split.h>
+#include <absl/strings/strip.h>
+#include <fmt/format.h>
+
+#include "sandbox/audit.h"
+#include "sandbox/landlock.h"
+#include "sandbox/policy.h"
+#include "sandbox/sha256.h"
+
+namespace sandbox {
+namespace {
+
+namespace fs = std::filesystem;
+
+// Bump when the key or the entry format changes.
+constexpr std::string_view kCacheVersion = "sandbox-cache-3";
+
+// Environment variables the compilers read that change their outputs. The
+// rest of the environment (MAKEFLAGS etc.) differs between builds and would
+// make every key unique.
+constexpr std::string_view kKeyedEnvironment[] = {
+    "CPATH=",           "C_INCLUDE_PATH=",  "CPLUS_INCLUDE_PATH=",
+    "COMPILER_PATH=",   "GCC_EXEC_PREFIX=", "SOURCE_DATE_EPOCH=",
+};
+
+std::system_error ErrnoError(std::string_view what, const fs::path &path) {
+  return std::system_error(errno, std::generic_category(),
+                           fmt::format("{} {}", what, path.native()));
+}
+
+// Feeds the contents of a regular file into `hash`, returns false if `path`
+// is not one.
+bool HashFile(const fs::path &path, Sha256 *hash) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT || errno == ENOTDIR) {
+      return false;
+    }
+    throw ErrnoError("failed to open", path);
+  }
+  auto fd_cleanup = absl::MakeCleanup([fd] { close(fd); });
+  struct stat st;
+  if (fstat(fd, &st)) {
+    throw ErrnoError("failed to stat", path);
+  }
+  if (!S_ISREG(st.st_mode)) {
+    return false;
+  }
+  char buffer[64 * 1024];
+  for (;;) {
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw ErrnoError("failed to read", path);
+    }
+    if (n == 0) {
+      return true;
+    }
+    hash->Update(buffer, n);
+  }
+}
+
+void HashRule(const fs::path &path, landlock::FSAccess access, Sha256 *hash) {
+  hash->Update(fmt::format("rule {} {}", access.Value(), path.native()));
+  hash->Update("\0", 1);
+  // Writable files may well be outputs, only what the compiler can
+  // exclusively read is an input.
+  if ((access & landlock::FSAccess::WRITE_FILE).Value() == 0 &&
+      !HashFile(path, hash)) {
+    hash->Update("\0", 1);
+  }
+}
+
+fs::path Normalize(const fs::path &path) {
+  return fs::absolute(path).lexically_normal();
+}
+
+// The action that restores the manifest of `action`'s inputs.
+CacheAction ManifestAction(const CacheAction &action) {
+  auto manifest = action.outputs.front();
+  manifest += ".cache_inputs";
+  return {.key = action.key, .outputs = {manifest}};
+}
+
+// The inputs of the depfile of `action` below its directory rules, sorted,
+// one per line.
+std::string MakeManifest(const CacheAction &action) {
+  std::set<fs::path> dirs;
+  for (const auto &dir : action.dirs) {
+    dirs.insert(Normalize(dir));
+  }
+  std::set<fs::path> inputs;
+  for (const auto &input : ParseDepfile(ReadFile(action.depfile))) {
+    auto path = Normalize(input);
+    for (auto p = path.parent_path(); !p.empty(); p = p.parent_path()) {
+      if (dirs.contains(p)) {
+        inputs.insert(path);
+        break;
+      }
+      if (p == p.root_path()) {
+        break;
+      }
+    }
+  }
+  std::string manifest;
+  for (const auto &input : inputs) {
+    manifest += input.native();
+    manifest += '\n';
+  }
+  return manifest;
+}
+
+// The action for the outputs, keyed by `action` and the inputs listed in
+// `manifest`.
+CacheAction OutputsAction(const CacheAction &action,
+                          std::string_view manifest) {
+  Sha256 hash;
+  hash.Update(action.key);
+  for (std::string_view input :
+       absl::StrSplit(manifest, '\n', absl::SkipEmpty())) {
+    HashRule(input, landlock::FSAccess::kReadonly, &hash);
+  }
+  return {.key = hash.HexDigest(), .outputs = action.outputs};
+}
+
+// The SHA-256 of the compiler's contents, nullopt if it can't be found.
+// Hashing a compiler takes longer than looking up the key, so the digest is
+// kept in `<cache_dir>/compilers` by path, inode, size and mtime.
+std::optional<std::string> CompilerDigest(const std::string &program,
+                                          const fs::path &cache_dir) {
+  struct stat st;
+  if (stat(program.c_str(), &st)) {
+    return std::nullopt;
+  }
+  fs::path memo;
+  if (!cache_dir.empty()) {
+    Sha256 id;
+    id.Update(fmt::format("{} {} {} {} {}.{}", program, st.st_dev, st.st_ino,
+                          st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec));
+    auto key = id.HexDigest();
+    memo = cache_dir / "compilers" / key.substr(0, 2) / key;
+    if (access(memo.c_str(), F_OK) == 0) {
+      return ReadFile(memo);
+    }
+  }
+  Sha256 hash;
+  if (!HashFile(program, &hash)) {
+    return std::nullopt;
+  }
+  auto digest = hash.HexDigest();
+  if (!memo.empty()) {
+    WriteFileAtomic(memo, digest);
+  }
+  return digest;
+}
+
+// Copies `from` to `to` through a temporary file, so readers never see a
+// partial file.
+void CopyAtomic(const fs::path &from, const fs::path &to) {
+  if (to.has_parent_path()) {
+    fs::create_directories(to.parent_path());
+  }
+  auto tmp = to;
+  tmp += fmt::format(".tmp.{}", getpid());
+  fs::copy_file(from, tmp, fs::copy_options::overwrite_existing);
+  fs::rename(tmp, to);
+}
+
+} // namespace
+
+std::optional<CacheAction> MakeCacheAction(const ParsedArgs &parsed,
+                                           const std::string &program,
+                                           char **envp) {
+  if (parsed.remainder.empty()) {
+    return std::nullopt;
+  }
+  CacheAction action;
+  bool compile = false;
+  fs::path object, depfile, source;
+  auto args = parsed.remainder.subspan(1);
+  for (size_t i = 0; i < args.size(); ++i) {
+    std::string_view arg = args[i];
+    fs::path *output = nullptr;
+    if (arg == "-c") {
+      compile = true;
+      // CMake passes the source right after it.
+      if (i + 1 < args.size() && !args[i + 1].starts_with("-")) {
+        source = args[i + 1];
+      }
+    } else if (absl::ConsumePrefix(&arg, "-MF")) {
+      output = &depfile;
+    } else if (absl::ConsumePrefix(&arg, "-o")) {
+      output = &object;
+    }
+    if (!output) {
+      continue;
+    }
+    if (arg.empty()) {
+      if (i + 1 == args.size()) {
+        return std::nullopt;
+      }
+      arg = args[++i];
+    }
+    *output = arg;
+  }
+  if (!compile || object.empty()) {
+    return std::nullopt;
+  }
+  action.dirs.insert(action.dirs.end(), parsed.ro_dirs.begin(),
+                     parsed.ro_dirs.end());
+  action.dirs.insert(action.dirs.end(), parsed.rw_dirs.begin(),
+                     parsed.rw_dirs.end());
+  action.outputs.push_back(object);
+  if (!depfile.empty()) {
+    action.outputs.push_back(depfile);
+  }
+
+  Sha256 hash;
+  hash.Update(kCacheVersion);
+  auto compiler = CompilerDigest(program, parsed.cache_dir);
+  if (!compiler) {
+    return std::nullopt;
+  }
+  hash.Update("\0", 1);
+  hash.Update(fmt::format("compiler {}", *compiler));
+  hash.Update("\0", 1);
+  for (const auto &arg : parsed.remainder) {
+    hash.Update(arg.c_str(), arg.size() + 1);
+  }
+  hash.Update(fs::current_path().native());
+  hash.Update("\0", 1);
+  for (char **env = envp; *env; ++env) {
+    for (auto keyed : kKeyedEnvironment) {
+      if (absl::StartsWith(*env, keyed)) {
+        hash.Update(*env, std::string_view(*env).size() + 1);
+      }
+    }
+  }
+  // A program that failed for lack of network must not share its results
+  // with one that had it.
+  if (parsed.deny_network) {
+    hash.Update("deny_network");
+    hash.Update("\0", 1);
+  }
+
+  // The source may be outside of the readonly rules, e.g. a unity source in
+  // the writable object directory.
+  if (!source.empty()) {
+    hash.Update(fmt::format("source {}", source.native()));
+    hash.Update("\0", 1);
+    HashFile(source, &hash);
+  }
+
+  for (const auto &p : parsed.ro_dirs) {
+    hash.Update(fmt::format("ro_dir {}", p.native()));
+    hash.Update("\0", 1);
+  }
+  for (const auto &p : parsed.rw_dirs) {
+    hash.Update(fmt::format("rw_dir {}", p.native()));
+    hash.Update("\0", 1);
+  }
+  for (const auto &p : parsed.ro_paths) {
+    HashRule(p, landlock::FSAccess::kReadonly, &hash);
+  }
+  for (const auto &p : parsed.rw_paths) {
+    HashRule(p, landlock::FSAccess::kAllFile, &hash);
+  }
+  if (!parsed.policy.empty()) {
+    auto policy = Policy::Map(parsed.policy);
+    for (const auto &rule : policy.Rules()) {
+      if (rule.type == PolicyRule::DIRECTORY) {
+        hash.Update(fmt::format("dir {} {}", rule.access, policy.Path(rule)));
+        hash.Update("\0", 1);
+        action.dirs.emplace_back(policy.Path(rule));
+      } else {
+        HashRule(policy.Path(rule), rule.access, &hash);
+      }
+    }
+  }
+  // Without a depfile, there is no telling what was read below them.
+  if (!action.dirs.empty() && depfile.empty()) {
+    return std::nullopt;
+  }
+  action.depfile = depfile;
+  action.key = hash.HexDigest();
+  return action;
+}
+
+bool RestoreAction(CacheBackend *cache, const CacheAction &action) {
+  if (action.dirs.empty()) {
+    return cache->Restore(action);
+  }
+  auto manifest = ManifestAction(action);
+  if (!cache->Restore(manifest)) {
+    return false;
+  }
+  return cache->Restore(
+      OutputsAction(action, ReadFile(manifest.outputs.front())));
+}
+
+void StoreAction(CacheBackend *cache, const CacheAction &action) {
+  if (action.dirs.empty()) {
+    cache->Store(action);
+    return;
+  }
+  // The outputs first, so the manifest never points at a missing entry.
+  auto manifest = MakeManifest(action);
+  cache->Store(OutputsAction(action, manifest));
+  auto manifest_action = ManifestAction(action);
+  WriteFileAtomic(manifest_action.outputs.front(), manifest);
+  cache->Store(manifest_action);
+}
+
+bool LocalCache::Restore(const CacheAction &action) {
+  auto entry_path = Entry(action.key);
+  if (access(entry_path.c_str(), F_OK)) {
+    return false;
+  }
+  auto entry = ReadFile(entry_path);
+  std::vector<std::pair<fs::path, fs::path>> copies;
+  for (std::string_view line : absl::StrSplit(entry, '\n', absl::SkipEmpty())) {
+    std::pair<std::string, std::string> fields =
+        absl::StrSplit(line, absl::MaxSplits(' ', 1));
+    auto blob = Blob(fields.first);
+    if (!fs::exists(blob)) {
+      // Somebody cleaned up the blobs, treat it as a miss.
+      return false;
+    }
+    copies.emplace_back(std::move(blob), fields.second);
+  }
+  if (copies.size() != action.outputs.size()) {
+    return false;
+  }
+  for (const auto &[blob, output] : copies) {
+    CopyAtomic(blob, output);
+  }
+  return true;
+}
+
+void LocalCache::Store(const CacheAction &action) {
+  std::string entry;
+  for (const auto &output : action.outputs) {
+    Sha256 hash;
+    if (!HashFile(output, &hash)) {
+      throw std::runtime_error(
+          fmt::format("missing output {}", output.native()));
+    }
+    auto digest = hash.HexDigest();
+    auto blob = Blob(digest);
+    if (!fs::exists(blob)) {
+      CopyAtomic(output, blob);
+    }
+    entry += fmt::format("{} {}\n", digest, output.native());
+  }
+  WriteFileAtomic(Entry(action.key), entry);
+}
+
+fs::path LocalCache::Blob(const std::string &digest) const {
+  return root_ / "cas" / digest.substr(0, 2) / digest;
+}
+
+fs::path LocalCache::Entry(const std::string &key) const {
+  return root_ / "ac" / key.substr(0, 2) / key;
+}
+
+std::string ReadFile(const fs::path &path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw ErrnoError("failed to open", path);
+  }
+  auto fd_cleanup = absl::MakeCleanup([fd] { close(fd); });
+  std::string contents;
+  char buffer[64 * 1024];
+  for (;;) {
+    ssize_t n = read(fd, buffer, sizeof(buffer));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw ErrnoError("failed to read", path);
+    }
+    if (n == 0) {
+      return contents;
+    }
+    contents.append(buffer, n);
+  }
+}
+
+void WriteFileAtomic(const fs::path &path, std::string_view contents) {
+  if (path.has_parent_path()) {
+    fs::create_directories(path.parent_path());
+  }
+  auto tmp = path;
+  tmp += fmt::format(".tmp.{}", getpid());
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw ErrnoError("failed to open", tmp);
+  }
+  auto fd_cleanup = absl::MakeCleanup([fd] { close(fd); });
+  while (!contents.empty()) {
+    ssize_t n = write(fd, contents.data(), contents.size());
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw ErrnoError("failed to write", tmp);
+    }
+    contents.remove_prefix(n);
+  }
+  fs::rename(tmp, path);
+}
+
+} // namespace sandbox
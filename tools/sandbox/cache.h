@@ -0,0 +1,98 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sandbox/args.h"
+
+namespace sandbox {
+
+// A compile that can be served from the cache.
+struct CacheAction {
+  // SHA-256 over everything that can change the outputs: the compiler, its
+  // arguments and working directory, the sandbox rules and the contents of
+  // every readonly file the sandbox lets it read. Paths are keyed as they
+  // are, so machines only share results if they build in the same
+  // directories.
+  std::string key;
+  // The object file and, if there is one, the depfile, as given on the
+  // command line.
+  std::vector<std::filesystem::path> outputs;
+  // The directory rules of the sandbox. If there are any, `key` only covers
+  // the rest, see RestoreAction.
+  std::vector<std::filesystem::path> dirs;
+  std::filesystem::path depfile;
+};
+
+// Describes the program in `parsed.remainder` as a cache action, nullopt if it
+// is not a compile (`-c`) with an explicit `-o`. `program` is the compiler as
+// resolved by the wrapper (see ResolveProgram). It is keyed by its contents,
+// so copies of the same compiler share results, and the digest is kept in
+// `<cache_dir>/compilers`. Throws if that can't be written.
+//
+// Directories in the sandbox (e.g. vcpkg include trees) are too large to hash
+// on every compile, so only the files the compile read below them are keyed,
+// see RestoreAction. Compiles with directory rules and no depfile (`-MF`) are
+// not cached.
+std::optional<CacheAction> MakeCacheAction(const ParsedArgs &parsed,
+                                           const std::string &program,
+                                           char **envp);
+
+// Somewhere to keep the outputs of cache actions.
+class CacheBackend {
+public:
+  virtual ~CacheBackend() = default;
+
+  // Copies the cached outputs of `action` into place, returns false on a
+  // miss. Throws if an output can't be written.
+  virtual bool Restore(const CacheAction &action) = 0;
+
+  // Records the outputs of a successful run of `action`. Throws on failure.
+  virtual void Store(const CacheAction &action) = 0;
+};
+
+// Restores the outputs of `action` from `cache`, returns false on a miss.
+//
+// With directory rules, this is two lookups: `key` maps to a manifest,
+// `<object>.cache_inputs`, listing the files below the directories the last
+// stored compile read (from its depfile). The outputs are keyed by `key` and
+// the contents of those files, so a header that changed in an include tree
+// misses. A header added to a directory that comes earlier in the include
+// path than the one a header was found in is not noticed.
+bool RestoreAction(CacheBackend *cache, const CacheAction &action);
+
+// Stores the outputs of a successful run of `action` in `cache`, and the
+// manifest of its inputs if it has directory rules. Throws on failure.
+void StoreAction(CacheBackend *cache, const CacheAction &action);
+
+// A content-addressed cache on the local disk:
+//   <root>/cas/<xx>/<sha256>  the outputs, addressed by their contents
+//   <root>/ac/<xx>/<key>      one "<sha256> <output>" line per output
+// where <xx> are the first two hex digits. All files are written to a
+// temporary name and renamed, so concurrent builds can share a cache.
+class LocalCache final : public CacheBackend {
+public:
+  explicit LocalCache(std::filesystem::path root) : root_(std::move(root)) {}
+
+  bool Restore(const CacheAction &action) override;
+  void Store(const CacheAction &action) override;
+
+private:
+  std::filesystem::path Blob(const std::string &digest) const;
+  std::filesystem::path Entry(const std::string &key) const;
+
+  std::filesystem::path root_;
+};
+
+// Reads a whole file, throws on failure.
+std::string ReadFile(const std::filesystem::path &path);
+
+// Writes `contents` to a temporary file renamed to `path`, so readers never
+// see a partial file. Throws on failure.
+void WriteFileAtomic(const std::filesystem::path &path,
+                     std::string_view contents);
+
+} // namespace sandbox
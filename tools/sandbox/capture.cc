@@ -0,0 +1,161 @@
+#include "sandbox/capture.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+#include <absl/cleanup/cleanup.h>
+#include <fmt/format.h>
+#include <zstd.h>
+
+namespace sandbox {
+namespace {
+
+// Fast enough to not show up next to a failed compile, and compiler output
+// compresses well anyway.
+constexpr int kCompressionLevel = 3;
+
+// A readonly mapping of the whole capture.
+class Mapping {
+public:
+  explicit Mapping(int fd) {
+    struct stat st;
+    if (fstat(fd, &st)) {
+      throw std::system_error(errno, std::generic_category(),
+                              "failed to stat captured output");
+    }
+    size_ = st.st_size;
+    if (size_ == 0) {
+      return;
+    }
+    data_ = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data_ == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(),
+                              "failed to map captured output");
+    }
+  }
+  Mapping(const Mapping &) = delete;
+  Mapping &operator=(const Mapping &) = delete;
+  ~Mapping() {
+    if (size_ > 0) {
+      munmap(data_, size_);
+    }
+  }
+
+  std::string_view View() const {
+    return {static_cast<const char *>(data_), size_};
+  }
+
+private:
+  void *data_ = nullptr;
+  size_t size_ = 0;
+};
+
+void WriteAll(int fd, std::string_view data) {
+  while (!data.empty()) {
+    ssize_t n = write(fd, data.data(), data.size());
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(),
+                              "failed to write captured output");
+    }
+    data.remove_prefix(n);
+  }
+}
+
+} // namespace
+
+CapturedOutput::CapturedOutput(CapturedOutput &&other)
+    : fd_(std::exchange(other.fd_, -1)) {}
+
+CapturedOutput::~CapturedOutput() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+CapturedOutput CapturedOutput::Create() {
+  int fd = memfd_create("sandbox_output", MFD_CLOEXEC);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "failed to create output capture");
+  }
+  return CapturedOutput(fd);
+}
+
+size_t CapturedOutput::Size() const {
+  struct stat st;
+  if (fstat(fd_, &st)) {
+    return 0;
+  }
+  return st.st_size;
+}
+
+size_t CapturedOutput::WriteHead(int fd, size_t max_lines) const {
+  Mapping mapping(fd_);
+  std::string_view output = mapping.View();
+  size_t end = 0;
+  size_t lines = 0;
+  while (end < output.size() && lines < max_lines) {
+    auto newline = output.find('\n', end);
+    end = newline == std::string_view::npos ? output.size() : newline + 1;
+    ++lines;
+  }
+  WriteAll(fd, output.substr(0, end));
+  std::string_view rest = output.substr(end);
+  return std::count(rest.begin(), rest.end(), '\n') +
+         (!rest.empty() && rest.back() != '\n');
+}
+
+void CapturedOutput::AppendCompressed(const std::filesystem::path &log,
+                                      std::string_view header) const {
+  Mapping mapping(fd_);
+  std::string_view output = mapping.View();
+  ZSTD_CCtx *ctx = ZSTD_createCCtx();
+  if (!ctx) {
+    throw std::runtime_error("failed to create zstd context");
+  }
+  auto ctx_cleanup = absl::MakeCleanup([ctx] { ZSTD_freeCCtx(ctx); });
+  ZSTD_CCtx_setParameter(ctx, ZSTD_c_compressionLevel, kCompressionLevel);
+  ZSTD_CCtx_setPledgedSrcSize(ctx, header.size() + output.size());
+
+  std::string frame(ZSTD_compressBound(header.size() + output.size()), '\0');
+  ZSTD_outBuffer out = {.dst = frame.data(), .size = frame.size(), .pos = 0};
+  auto compress = [&](std::string_view data, ZSTD_EndDirective end) {
+    ZSTD_inBuffer in = {.src = data.data(), .size = data.size(), .pos = 0};
+    size_t left;
+    do {
+      left = ZSTD_compressStream2(ctx, &out, &in, end);
+      if (ZSTD_isError(left)) {
+        throw std::runtime_error(fmt::format("failed to compress output: {}",
+                                             ZSTD_getErrorName(left)));
+      }
+    } while (end == ZSTD_e_end ? left != 0 : in.pos < in.size);
+  };
+  compress(header, ZSTD_e_continue);
+  compress(output, ZSTD_e_end);
+  frame.resize(out.pos);
+
+  int fd = open(log.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            fmt::format("failed to open {}", log.native()));
+  }
+  auto fd_cleanup = absl::MakeCleanup([fd] { close(fd); });
+  ssize_t written = write(fd, frame.data(), frame.size());
+  if (written != static_cast<ssize_t>(frame.size())) {
+    throw std::system_error(errno, std::generic_category(),
+                            fmt::format("failed to write {}", log.native()));
+  }
+}
+
+} // namespace sandbox
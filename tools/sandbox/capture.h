@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+
+namespace sandbox {
+
+// The stdout and stderr of a program run with --capture_output, in one memfd
+// so both stay in the order they were written, and nothing reaches the
+// terminal while the program runs.
+class CapturedOutput {
+public:
+  CapturedOutput(const CapturedOutput &) = delete;
+  CapturedOutput(CapturedOutput &&other);
+  CapturedOutput &operator=(const CapturedOutput &) = delete;
+  CapturedOutput &operator=(CapturedOutput &&) = delete;
+  ~CapturedOutput();
+
+  // Creates an empty capture, throws on failure.
+  static CapturedOutput Create();
+
+  // The descriptor for the program's stdout and stderr, see SpawnExec.
+  int Fd() const { return fd_; }
+
+  // The bytes written so far.
+  size_t Size() const;
+
+  // Writes the first `max_lines` lines to `fd` in a single write, so the
+  // output of concurrent wrappers isn't interleaved. Returns the number of
+  // lines left out.
+  size_t WriteHead(int fd, size_t max_lines) const;
+
+  // Appends `header` and the output as one zstd frame to `log`. A single
+  // write with O_APPEND, so concurrent wrappers can share a log and
+  // `zstdcat` reads all of their frames in order.
+  //
+  // Throws on failure.
+  void AppendCompressed(const std::filesystem::path &log,
+                        std::string_view header) const;
+
+private:
+  explicit CapturedOutput(int fd) : fd_(fd) {}
+
+  int fd_;
+};
+
+} // namespace sandbox
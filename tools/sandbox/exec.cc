@@ -0,0 +1,246 @@
+#include "sandbox/exec.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <iterator>
+#include <sched.h>
+#include <string_view>
+#include <system_error>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include <absl/strings/str_split.h>
+#include <absl/strings/strip.h>
+#include <fmt/format.h>
+
+namespace sandbox {
+namespace {
+
+// Plenty for the few calls the child makes before the exec.
+constexpr size_t kChildStackSize = 64 * 1024;
+
+constexpr int kForwardedSignals[] = {SIGINT, SIGTERM, SIGHUP};
+
+// The child SpawnExec waits for, and the last signal ForwardSignals caught.
+std::atomic<pid_t> forward_pid = 0;
+volatile sig_atomic_t forwarded_signal = 0;
+
+void ForwardSignal(int sig) {
+  forwarded_signal = sig;
+  if (pid_t pid = forward_pid; pid > 0) {
+    kill(pid, sig);
+  }
+}
+
+// Shared by SpawnExec and its child, which runs on the same memory.
+struct SpawnState {
+  const char *program;
+  char *const *argv;
+  char **envp;
+  const landlock::Ruleset *ruleset;
+  int output_fd;
+  // The wrapper, the child must not outlive it.
+  pid_t parent;
+  // The signal mask of the caller, for the child to restore.
+  sigset_t mask;
+  int64_t apply_ns = 0;
+  // The errno of the failed step if the program did not start.
+  int error = 0;
+  bool sandbox_failed = false;
+};
+
+int SpawnChild(void *arg) {
+  auto *state = static_cast<SpawnState *>(arg);
+  // Handlers of the wrapper would run on its memory, the exec resets them
+  // anyway.
+  for (int sig = 1; sig < NSIG; ++sig) {
+    struct sigaction action;
+    if (sigaction(sig, nullptr, &action) == 0 &&
+        action.sa_handler != SIG_DFL && action.sa_handler != SIG_IGN) {
+      struct sigaction reset = {};
+      reset.sa_handler = SIG_DFL;
+      sigaction(sig, &reset, nullptr);
+    }
+  }
+  // If the wrapper is killed (e.g. by a fork server whose client went away),
+  // so is the program. The wrapper may have died before this.
+  if (prctl(PR_SET_PDEATHSIG, SIGKILL)) {
+    state->error = errno;
+    _exit(127);
+  }
+  if (getppid() != state->parent) {
+    _exit(127);
+  }
+  if (state->output_fd >= 0 && (dup2(state->output_fd, STDOUT_FILENO) < 0 ||
+                                 dup2(state->output_fd, STDERR_FILENO) < 0)) {
+    state->error = errno;
+    _exit(127);
+  }
+  if (state->ruleset) {
+    auto start = std::chrono::steady_clock::now();
+    state->error = state->ruleset->TryApply();
+    state->apply_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    if (state->error) {
+      state->sandbox_failed = true;
+      _exit(1);
+    }
+  }
+  sigprocmask(SIG_SETMASK, &state->mask, nullptr);
+  execve(state->program, state->argv, state->envp);
+  state->error = errno;
+  _exit(127);
+}
+
+} // namespace
+
+int Exec(std::span<std::string> args) { return Exec(args, environ); }
+
+int Exec(std::span<std::string> args, char **envp) {
+  std::vector<char *> c_args;
+  c_args.reserve(args.size() + 1);
+  for (const auto &arg : args) {
+    c_args.push_back(const_cast<char *>(arg.c_str()));
+  }
+  c_args.push_back(nullptr);
+  // Not execvpe, which searches the PATH of the caller rather than of envp.
+  std::string program = ResolveProgram(args.front(), envp);
+  errno = ENOENT;
+  if (program.empty() || execve(program.c_str(), c_args.data(), envp)) {
+    auto err = std::system_error(
+        errno, std::generic_category(),
+        fmt::format("failed to exec \"{}\"", fmt::join(args, " ")));
+    fmt::println(stderr, "{}", err.what());
+    return 1;
+  }
+  return 0;
+}
+
+std::string ResolveProgram(const std::string &name, char **envp) {
+  if (name.find('/') != std::string::npos) {
+    return name;
+  }
+  std::string_view path_env = "/usr/bin:/bin";
+  for (char **env = envp; *env; ++env) {
+    std::string_view var = *env;
+    if (absl::ConsumePrefix(&var, "PATH=")) {
+      path_env = var;
+      break;
+    }
+  }
+  for (std::string_view dir : absl::StrSplit(path_env, ':')) {
+    auto candidate = fmt::format("{}/{}", dir.empty() ? "." : dir, name);
+    if (access(candidate.c_str(), X_OK) == 0) {
+      return candidate;
+    }
+  }
+  return {};
+}
+
+int SpawnExec(const std::string &program, std::span<std::string> args,
+              char **envp, const landlock::Ruleset *ruleset,
+              ExecStats *stats, SandboxStats *sandbox, int output_fd) {
+  std::vector<char *> c_args;
+  c_args.reserve(args.size() + 1);
+  for (const auto &arg : args) {
+    c_args.push_back(const_cast<char *>(arg.c_str()));
+  }
+  c_args.push_back(nullptr);
+  SpawnState state = {
+      .program = program.c_str(),
+      .argv = c_args.data(),
+      .envp = envp,
+      .ruleset = ruleset,
+      .output_fd = output_fd,
+      .parent = getpid(),
+  };
+
+  void *stack = mmap(nullptr, kChildStackSize, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+  if (stack == MAP_FAILED) {
+    throw std::system_error(errno, std::generic_category(),
+                            "failed to map child stack");
+  }
+  // No handler may run in the child before it has reset them.
+  sigset_t all;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &state.mask);
+  auto start = std::chrono::steady_clock::now();
+  // The caller is suspended until the child has exec'd or exited.
+  pid_t pid = clone(SpawnChild, static_cast<char *>(stack) + kChildStackSize,
+                    CLONE_VM | CLONE_VFORK | SIGCHLD, &state);
+  int clone_errno = errno;
+  auto execed = std::chrono::steady_clock::now();
+  // Before the signals are unblocked, so none of them is lost.
+  if (pid > 0) {
+    forward_pid = pid;
+    if (forwarded_signal) {
+      kill(pid, forwarded_signal);
+    }
+  }
+  pthread_sigmask(SIG_SETMASK, &state.mask, nullptr);
+  munmap(stack, kChildStackSize);
+  if (pid < 0) {
+    throw std::system_error(clone_errno, std::generic_category(),
+                            "failed to start child");
+  }
+  if (stats) {
+    stats->exec_latency_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(execed - start)
+            .count();
+  }
+  if (sandbox) {
+    sandbox->apply_ns = state.apply_ns;
+  }
+
+  int status = 0;
+  while (wait4(pid, &status, 0, stats ? &stats->usage : nullptr) < 0) {
+    if (errno != EINTR) {
+      forward_pid = 0;
+      throw std::system_error(errno, std::generic_category(),
+                              "failed to wait for child");
+    }
+  }
+  forward_pid = 0;
+  if (state.error) {
+    auto err = std::system_error(
+        state.error, std::generic_category(),
+        state.sandbox_failed
+            ? "Failed to apply landlock ruleset"
+            : fmt::format("failed to exec \"{}\"", fmt::join(args, " ")));
+    fmt::println(stderr, "{}", err.what());
+    return 1;
+  }
+  if (WIFSIGNALED(status)) {
+    return 128 + WTERMSIG(status);
+  }
+  return WEXITSTATUS(status);
+}
+
+ForwardSignals::ForwardSignals() {
+  struct sigaction action = {};
+  action.sa_handler = ForwardSignal;
+  sigemptyset(&action.sa_mask);
+  for (size_t i = 0; i < std::size(kForwardedSignals); ++i) {
+    sigaction(kForwardedSignals[i], &action, &old_[i]);
+  }
+}
+
+ForwardSignals::~ForwardSignals() {
+  for (size_t i = 0; i < std::size(kForwardedSignals); ++i) {
+    sigaction(kForwardedSignals[i], &old_[i], nullptr);
+  }
+  if (int sig = forwarded_signal) {
+    forwarded_signal = 0;
+    raise(sig);
+  }
+}
+
+} // namespace sandbox
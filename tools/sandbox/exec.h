@@ -0,0 +1,61 @@
+#pragma once
+
+#include <csignal>
+#include <span>
+#include <string>
+
+#include "sandbox/landlock.h"
+#include "sandbox/stats.h"
+
+namespace sandbox {
+
+// Replaces the current process with `args`, searching PATH for the program
+// (see ResolveProgram).
+//
+// Only returns (with 1) if the exec failed, after logging the error.
+int Exec(std::span<std::string> args);
+
+// Same as above, but with an explicit environment for the new program, whose
+// PATH is searched.
+int Exec(std::span<std::string> args, char **envp);
+
+// Searches the PATH of `envp` for `name` like execvpe would. Names with a
+// slash are returned as is. Returns an empty string if `name` isn't found,
+// which execve fails with ENOENT.
+std::string ResolveProgram(const std::string &name, char **envp);
+
+// Runs `program` (see ResolveProgram) with `args` in a child process and
+// waits for it. If `ruleset` is given, the child restricts itself to it right
+// before the exec. The child is killed when the caller dies.
+//
+// The child shares the memory of the caller until the exec, like vfork, so
+// starting it costs the same no matter how much the wrapper has mapped. The
+// ruleset is built by the caller, the child does nothing but syscalls.
+//
+// Returns the exit code of the child, 128 + the signal if it was killed. If
+// `stats` is given, the time until the exec and the resource usage of the
+// child are recorded in it, and the time to apply the ruleset in `sandbox`.
+// If `output_fd` is given, the child's stdout and stderr are redirected to
+// it.
+int SpawnExec(const std::string &program, std::span<std::string> args,
+              char **envp, const landlock::Ruleset *ruleset,
+              ExecStats *stats = nullptr, SandboxStats *sandbox = nullptr,
+              int output_fd = -1);
+
+// While alive, SIGINT, SIGTERM and SIGHUP don't kill the caller, they are
+// forwarded to the child SpawnExec waits for instead, so the caller can clean
+// up after it (e.g. remove a private tmp). The destructor restores the
+// previous handlers and raises a signal that arrived again, so the caller
+// still dies of it.
+class ForwardSignals {
+public:
+  ForwardSignals();
+  ForwardSignals(const ForwardSignals &) = delete;
+  ForwardSignals &operator=(const ForwardSignals &) = delete;
+  ~ForwardSignals();
+
+private:
+  struct sigaction old_[3];
+};
+
+} // namespace sandbox
@@ -0,0 +1,514 @@
+#include "sandbox/fork_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <poll.h>
+#include <stdexcept>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+#include <absl/cleanup/cleanup.h>
+#include <absl/strings/strip.h>
+#include <fmt/format.h>
+
+#include "sandbox/landlock.h"
+#include "sandbox/ruleset_cache.h"
+#include "sandbox/run.h"
+#include "sandbox/sandbox.h"
+
+namespace sandbox {
+namespace {
+
+// Guards against talking to something that is not a fork server, and against
+// a client and server from different builds of the wrapper.
+constexpr uint32_t kRequestMagic = 0x4c4c4653; // "LLFS"
+
+// The descriptors passed from the client: stdin, stdout and stderr.
+constexpr int kPassedFds = 3;
+
+// How long a program whose client went away gets to clean up after SIGTERM
+// (e.g. remove its --private_tmp) before it is killed.
+constexpr auto kKillGracePeriod = std::chrono::seconds(5);
+
+struct RequestHeader {
+  uint32_t magic;
+  uint32_t argc;
+  uint32_t envc;
+  uint32_t payload_size;
+};
+
+// A request as received by the server. The payload holds the working
+// directory, the arguments and the environment as NUL terminated strings.
+struct Request {
+  std::string cwd;
+  std::vector<std::string> args;
+  std::vector<std::string> env;
+};
+
+sockaddr_un MakeAddress(const std::filesystem::path &socket_path) {
+  sockaddr_un addr = {};
+  addr.sun_family = AF_UNIX;
+  const auto &native = socket_path.native();
+  if (native.size() >= sizeof(addr.sun_path)) {
+    throw std::runtime_error(
+        fmt::format("socket path is too long: {}", native));
+  }
+  std::memcpy(addr.sun_path, native.c_str(), native.size() + 1);
+  return addr;
+}
+
+void WriteAll(int fd, std::string_view data) {
+  while (!data.empty()) {
+    ssize_t n = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(),
+                              "failed to write to fork server socket");
+    }
+    data.remove_prefix(n);
+  }
+}
+
+// Returns false on a clean EOF before any data was read.
+bool ReadAll(int fd, void *data, size_t size) {
+  auto *out = static_cast<char *>(data);
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = read(fd, out + done, size - done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(),
+                              "failed to read from fork server socket");
+    }
+    if (n == 0) {
+      if (done == 0) {
+        return false;
+      }
+      throw std::runtime_error("fork server socket closed mid message");
+    }
+    done += n;
+  }
+  return true;
+}
+
+void AppendString(std::string *payload, std::string_view s) {
+  payload->append(s);
+  payload->push_back('\0');
+}
+
+// Sends the header and the stdio descriptors, then the payload.
+void SendRequest(int fd, std::span<const std::string> args) {
+  std::string payload;
+  AppendString(&payload, std::filesystem::current_path().native());
+  for (const auto &arg : args) {
+    AppendString(&payload, arg);
+  }
+  uint32_t envc = 0;
+  for (char **env = environ; *env; ++env, ++envc) {
+    AppendString(&payload, *env);
+  }
+  RequestHeader header = {
+      .magic = kRequestMagic,
+      .argc = static_cast<uint32_t>(args.size()),
+      .envc = envc,
+      .payload_size = static_cast<uint32_t>(payload.size()),
+  };
+
+  iovec iov = {.iov_base = &header, .iov_len = sizeof(header)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kPassedFds)] = {};
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int) * kPassedFds);
+  int fds[kPassedFds] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+  std::memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+  ssize_t n;
+  do {
+    n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "failed to send request to fork server");
+  }
+  const char *header_bytes = reinterpret_cast<const char *>(&header);
+  WriteAll(fd, std::string_view(header_bytes + n, sizeof(header) - n));
+  WriteAll(fd, payload);
+}
+
+// Receives a request, installing the passed descriptors as stdio.
+Request ReceiveRequest(int fd) {
+  RequestHeader header;
+  iovec iov = {.iov_base = &header, .iov_len = sizeof(header)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kPassedFds)] = {};
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  ssize_t n;
+  do {
+    n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+  } while (n < 0 && errno == EINTR);
+  if (n < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "failed to receive fork server request");
+  }
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS ||
+      cmsg->cmsg_len != CMSG_LEN(sizeof(int) * kPassedFds)) {
+    throw std::runtime_error("fork server request is missing descriptors");
+  }
+  int fds[kPassedFds];
+  std::memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+  for (int i = 0; i < kPassedFds; ++i) {
+    if (dup2(fds[i], i) < 0) {
+      throw std::system_error(errno, std::generic_category(),
+                              "failed to install client descriptors");
+    }
+    close(fds[i]);
+  }
+  if (n < static_cast<ssize_t>(sizeof(header)) &&
+      !ReadAll(fd, reinterpret_cast<char *>(&header) + n,
+               sizeof(header) - n)) {
+    throw std::runtime_error("fork server request is truncated");
+  }
+  if (header.magic != kRequestMagic) {
+    throw std::runtime_error("invalid fork server request");
+  }
+  std::string payload(header.payload_size, '\0');
+  if (!ReadAll(fd, payload.data(), payload.size())) {
+    throw std::runtime_error("fork server request is truncated");
+  }
+
+  Request request;
+  std::string_view rest = payload;
+  auto next = [&rest]() {
+    auto end = rest.find('\0');
+    if (end == std::string_view::npos) {
+      throw std::runtime_error("malformed fork server request");
+    }
+    std::string s(rest.substr(0, end));
+    rest.remove_prefix(end + 1);
+    return s;
+  };
+  request.cwd = next();
+  for (uint32_t i = 0; i < header.argc; ++i) {
+    request.args.push_back(next());
+  }
+  for (uint32_t i = 0; i < header.envc; ++i) {
+    request.env.push_back(next());
+  }
+  return request;
+}
+
+// Runs in the forked child, never returns.
+[[noreturn]] void RunChild(int client_fd, const AutomaticPaths &automatic,
+                           const RulesetCache &rulesets,
+                           const RemoteCacheFactory &remote) {
+  try {
+    auto request = ReceiveRequest(client_fd);
+    close(client_fd);
+    if (chdir(request.cwd.c_str())) {
+      throw std::system_error(
+          errno, std::generic_category(),
+          fmt::format("failed to change directory to {}", request.cwd));
+    }
+    auto parsed = ParseCommandLine(request.args);
+    if (parsed.remainder.empty() || !parsed.fork_server.empty()) {
+      throw std::runtime_error("invalid arguments, a fork server can only run "
+                               "programs given after --");
+    }
+    std::vector<char *> envp;
+    envp.reserve(request.env.size() + 1);
+    for (auto &env : request.env) {
+      envp.push_back(env.data());
+    }
+    envp.push_back(nullptr);
+    _exit(Run(parsed, &automatic, envp.data(), remote, &rulesets));
+  } catch (const std::exception &ex) {
+    fmt::println(stderr, "fork server: {}", ex.what());
+  }
+  _exit(1);
+}
+
+int PidfdOpen(pid_t pid) { return syscall(SYS_pidfd_open, pid, 0); }
+
+// A program started for a connected client.
+struct Session {
+  int client_fd;
+  pid_t pid;
+  int pid_fd;
+  // Set once the client went away and the program got SIGTERM.
+  std::optional<std::chrono::steady_clock::time_point> kill_at;
+};
+
+void FinishSession(const Session &session) {
+  int status = 0;
+  while (waitpid(session.pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  int32_t code = 1;
+  if (WIFEXITED(status)) {
+    code = WEXITSTATUS(status);
+  } else if (WIFSIGNALED(status)) {
+    code = 128 + WTERMSIG(status);
+  }
+  try {
+    WriteAll(session.client_fd,
+             std::string_view(reinterpret_cast<const char *>(&code),
+                              sizeof(code)));
+  } catch (const std::exception &) {
+    // The client went away, nobody is left to report to.
+  }
+  close(session.client_fd);
+  close(session.pid_fd);
+}
+
+bool PeerIsSameUser(int fd) {
+  ucred cred;
+  socklen_t len = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len)) {
+    return false;
+  }
+  return cred.uid == getuid();
+}
+
+int Listen(const std::filesystem::path &socket_path) {
+  auto addr = MakeAddress(socket_path);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "failed to create socket");
+  }
+  auto fd_cleanup = absl::MakeCleanup([fd] { close(fd); });
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0) {
+    throw std::runtime_error(fmt::format(
+        "a fork server is already listening on {}", socket_path.native()));
+  }
+  // Nobody is listening, so whatever is left there is stale.
+  unlink(socket_path.c_str());
+  close(fd);
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            "failed to create socket");
+  }
+  // Only the current user may start programs through the server.
+  mode_t old_umask = umask(0077);
+  int err = bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+  umask(old_umask);
+  if (err || listen(fd, SOMAXCONN)) {
+    throw std::system_error(
+        errno, std::generic_category(),
+        fmt::format("failed to listen on {}", socket_path.native()));
+  }
+  std::move(fd_cleanup).Cancel();
+  return fd;
+}
+
+} // namespace
+
+int RunForkServer(const ParsedArgs &parsed,
+                  const RemoteCacheFactory &remote) {
+  int listen_fd;
+  try {
+    listen_fd = Listen(parsed.fork_server);
+  } catch (const std::exception &ex) {
+    fmt::println(stderr, "fork server: {}", ex.what());
+    return 1;
+  }
+  auto listen_cleanup = absl::MakeCleanup([listen_fd, &parsed] {
+    close(listen_fd);
+    unlink(parsed.fork_server.c_str());
+  });
+  // Probe the kernel once, the children inherit the result.
+  landlock::Probe();
+  std::optional<AutomaticPaths> automatic;
+  std::optional<RulesetCache> rulesets;
+  try {
+    automatic.emplace(AutomaticPaths::Open());
+    rulesets.emplace(RulesetCache::Create());
+  } catch (const std::exception &ex) {
+    fmt::println(stderr, "fork server: {}", ex.what());
+    return 1;
+  }
+
+  std::vector<Session> sessions;
+  std::vector<pollfd> pollfds;
+  while (true) {
+    // Layout: the listening socket, the ruleset cache, then a client and pid
+    // fd per session.
+    pollfds.clear();
+    pollfds.push_back({.fd = listen_fd, .events = POLLIN, .revents = 0});
+    pollfds.push_back(
+        {.fd = rulesets->ReceiveFd(), .events = POLLIN, .revents = 0});
+    auto now = std::chrono::steady_clock::now();
+    int timeout_ms = -1;
+    for (const auto &session : sessions) {
+      // A hung up client would wake every poll, only the program is left to
+      // wait for.
+      pollfds.push_back({.fd = session.kill_at ? -1 : session.client_fd,
+                         .events = POLLRDHUP,
+                         .revents = 0});
+      pollfds.push_back({.fd = session.pid_fd, .events = POLLIN, .revents = 0});
+      if (session.kill_at) {
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(
+            *session.kill_at - now);
+        int left_ms = std::max<int>(0, left.count());
+        timeout_ms = timeout_ms < 0 ? left_ms : std::min(timeout_ms, left_ms);
+      }
+    }
+    if (sessions.empty() && parsed.idle_timeout > 0) {
+      timeout_ms = parsed.idle_timeout * 1000;
+    }
+    int ready = poll(pollfds.data(), pollfds.size(), timeout_ms);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fmt::println(stderr, "fork server: poll failed: {}",
+                   std::strerror(errno));
+      return 1;
+    }
+    if (ready == 0 && sessions.empty()) {
+      return 0;
+    }
+
+    now = std::chrono::steady_clock::now();
+    std::vector<Session> running;
+    running.reserve(sessions.size());
+    for (size_t i = 0; i < sessions.size(); ++i) {
+      auto session = sessions[i];
+      const auto &client = pollfds[2 + 2 * i];
+      const auto &child = pollfds[3 + 2 * i];
+      if (child.revents & POLLIN) {
+        FinishSession(session);
+        continue;
+      }
+      if (client.revents & (POLLRDHUP | POLLHUP | POLLERR)) {
+        // Nobody is waiting on the result anymore (e.g. the build was
+        // interrupted), so don't let the program linger. The wrapper
+        // forwards the signal to a program it runs in a child, and the
+        // child dies with the wrapper.
+        kill(session.pid, SIGTERM);
+        session.kill_at = now + kKillGracePeriod;
+      } else if (session.kill_at && now >= *session.kill_at) {
+        kill(session.pid, SIGKILL);
+        FinishSession(session);
+        continue;
+      }
+      running.push_back(session);
+    }
+    sessions = std::move(running);
+
+    // Before forking, so the next child already finds what the last one
+    // built.
+    if (pollfds[1].revents & POLLIN) {
+      rulesets->Receive();
+    }
+
+    if (pollfds[0].revents & POLLIN) {
+      int client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (client_fd < 0) {
+        continue;
+      }
+      if (!PeerIsSameUser(client_fd)) {
+        close(client_fd);
+        continue;
+      }
+      pid_t pid = fork();
+      if (pid == 0) {
+        RunChild(client_fd, *automatic, *rulesets, remote);
+      }
+      int pid_fd = pid > 0 ? PidfdOpen(pid) : -1;
+      if (pid_fd < 0) {
+        fmt::println(stderr, "fork server: failed to start program: {}",
+                     std::strerror(errno));
+        if (pid > 0) {
+          kill(pid, SIGKILL);
+          waitpid(pid, nullptr, 0);
+        }
+        close(client_fd);
+        continue;
+      }
+      sessions.push_back(
+          {.client_fd = client_fd, .pid = pid, .pid_fd = pid_fd});
+    }
+  }
+}
+
+std::optional<int> RunOnForkServer(std::span<std::string> args) {
+  std::string socket_path;
+  std::vector<std::string> forwarded;
+  forwarded.reserve(args.size());
+  for (size_t i = 0; i < args.size(); ++i) {
+    std::string_view arg = args[i];
+    if (arg == "--") {
+      forwarded.insert(forwarded.end(), args.begin() + i, args.end());
+      break;
+    }
+    if (absl::ConsumePrefix(&arg, "--connect")) {
+      if (absl::ConsumePrefix(&arg, "=")) {
+        socket_path = arg;
+        continue;
+      }
+      if (arg.empty() && i + 1 < args.size()) {
+        socket_path = args[++i];
+        continue;
+      }
+    }
+    forwarded.push_back(args[i]);
+  }
+  if (socket_path.empty()) {
+    return std::nullopt;
+  }
+
+  sockaddr_un addr;
+  try {
+    addr = MakeAddress(socket_path);
+  } catch (const std::exception &) {
+    return std::nullopt;
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+  auto fd_cleanup = absl::MakeCleanup([fd] { close(fd); });
+  if (connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr))) {
+    return std::nullopt;
+  }
+  try {
+    SendRequest(fd, forwarded);
+    int32_t code;
+    if (!ReadAll(fd, &code, sizeof(code))) {
+      throw std::runtime_error("fork server closed the connection");
+    }
+    return code;
+  } catch (const std::exception &ex) {
+    fmt::println(stderr, "fork server: {}", ex.what());
+    return 1;
+  }
+}
+
+} // namespace sandbox
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <optional>
+#include <span>
+#include <string>
+
+#include "sandbox/args.h"
+#include "sandbox/run.h"
+
+namespace sandbox {
+
+// A fork server keeps a single long lived wrapper process per build directory
+// that starts sandboxed programs on behalf of thin clients.
+//
+// The client (`--connect=<socket>`) forwards its arguments, environment,
+// working directory and stdio descriptors over a Unix socket. The server forks,
+// and the child sets up the exact same sandbox the wrapper would have applied
+// in-process before exec'ing the program. The server then reports the exit
+// code back to the client. The automatic system paths are opened once when the
+// server starts, the rulesets the children build are kept for the next compile
+// of the same target (see RulesetCache), and a client going away kills the
+// program it started.
+
+// Runs a fork server listening on `parsed.fork_server`, returns the exit code
+// for the wrapper once the server stops.
+int RunForkServer(const ParsedArgs &parsed,
+                  const RemoteCacheFactory &remote = {});
+
+// If `args` contain `--connect=<socket>` before the `--`, runs the program on
+// that fork server and returns its exit code.
+//
+// Returns std::nullopt if there is no `--connect` flag or no server is
+// listening on the socket, the caller should then run the program directly.
+std::optional<int> RunOnForkServer(std::span<std::string> args);
+
+} // namespace sandbox
@@ -0,0 +1,175 @@
+#include "sandbox/landlock.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+#include <absl/cleanup/cleanup.h>
+#include <fmt/format.h>
+
+/*
+ * sys_landlock_create_ruleset() flags:
+ *
+ * - %LANDLOCK_CREATE_RULESET_VERSION: Get the highest supported Landlock ABI
+ *   version.
+ */
+#ifndef LANDLOCK_CREATE_RULESET_VERSION
+#define LANDLOCK_CREATE_RULESET_VERSION (1U << 0)
+#endif
+
+#define __NR_landlock_create_ruleset 444
+#define __NR_landlock_add_rule 445
+#define __NR_landlock_restrict_self 446
+
+namespace sandbox {
+namespace landlock {
+
+int CreateRuleset(const struct ruleset_attr *const attr, const size_t size,
+                  const uint32_t flags) {
+  return syscall(__NR_landlock_create_ruleset, attr, size, flags);
+}
+
+int AddRule(const int ruleset_fd, const enum rule_type rule_type,
+            const void *const rule_attr, const uint32_t flags) {
+  return syscall(__NR_landlock_add_rule, ruleset_fd, rule_type, rule_attr,
+                 flags);
+}
+
+int RestrictSelf(const int ruleset_fd, const uint32_t flags) {
+  return syscall(__NR_landlock_restrict_self, ruleset_fd, flags);
+}
+
+const Capabilities &Probe() {
+  static const Capabilities capabilities = Capabilities::ForABI(
+      CreateRuleset(NULL, 0, LANDLOCK_CREATE_RULESET_VERSION));
+  return capabilities;
+}
+
+int ABIVersion() { return Probe().abi; }
+
+bool Enabled() { return Probe().Enabled(); }
+
+bool CanRestrictNetwork() { return Probe().handled_access_net != 0; }
+
+FSAccess FSAccess::Readonly() {
+  static const FSAccess access = kReadonly & Probe().handled_access_fs;
+  return access;
+}
+
+FSAccess FSAccess::AllFile() {
+  static const FSAccess access = kAllFile & Probe().handled_access_fs;
+  return access;
+}
+
+FSAccess FSAccess::AllDir() {
+  static const FSAccess access = kAllDir & Probe().handled_access_fs;
+  return access;
+}
+
+Ruleset::Ruleset(Ruleset &&other)
+    : ruleset_fd_(std::exchange(other.ruleset_fd_, -1)),
+      rule_count_(other.rule_count_) {}
+
+Ruleset::~Ruleset() {
+  if (ruleset_fd_ >= 0) {
+    close(ruleset_fd_);
+  }
+}
+
+Ruleset Ruleset::Create(bool deny_network) {
+  // Older kernels accept the larger struct as long as the fields they don't
+  // know are zero.
+  ruleset_attr ruleset_attr = {
+      .handled_access_fs = FSAccess::All().Value(),
+      .handled_access_net = deny_network ? Probe().handled_access_net : 0,
+  };
+  int fd = CreateRuleset(&ruleset_attr, sizeof(ruleset_attr), 0);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category());
+  }
+  return Ruleset(fd);
+}
+
+void Ruleset::Allow(const std::filesystem::path path,
+                    const FSAccess allowed_access) {
+  // Open first and stat the descriptor, which resolves the path only once.
+  int parent_fd = open(path.native().c_str(), O_PATH | O_CLOEXEC);
+  if (parent_fd < 0) {
+    if (errno == ENOENT) {
+      return;
+    }
+    throw std::system_error(
+        errno, std::generic_category(),
+        fmt::format("failed to open path: {}", path.native()));
+  }
+  auto fd_cleanup = absl::MakeCleanup([parent_fd] { close(parent_fd); });
+  struct stat st;
+  if (fstat(parent_fd, &st)) {
+    throw std::system_error(
+        errno, std::generic_category(),
+        fmt::format("failed to stat path: {}", path.native()));
+  }
+  FSAccess access = allowed_access;
+  if (!S_ISDIR(st.st_mode)) {
+    access = access & FSAccess::AllFile();
+  }
+  path_beneath_attr path_beneath = {
+      .allowed_access = access.Value(),
+      .parent_fd = parent_fd,
+  };
+  int error = AddRule(ruleset_fd_, rule_type::RULE_PATH_BENEATH, &path_beneath,
+                      /*flags=*/0);
+  if (error) {
+    throw std::system_error(
+        errno, std::generic_category(),
+        fmt::format("failed to update ruleset: path={}, access={}",
+                    path.native(), access.Value()));
+  }
+  ++rule_count_;
+}
+
+void Ruleset::AllowFd(int path_fd, const FSAccess allowed_access) {
+  path_beneath_attr path_beneath = {
+      .allowed_access = allowed_access.Value(),
+      .parent_fd = path_fd,
+  };
+  int error = AddRule(ruleset_fd_, rule_type::RULE_PATH_BENEATH, &path_beneath,
+                      /*flags=*/0);
+  if (error) {
+    throw std::system_error(
+        errno, std::generic_category(),
+        fmt::format("failed to update ruleset: fd={}, access={}", path_fd,
+                    allowed_access.Value()));
+  }
+  ++rule_count_;
+}
+
+void Ruleset::Apply() {
+  int err = prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0);
+  if (err) {
+    throw std::system_error(errno, std::generic_category(),
+                            "failed to restrict process to new privileges");
+  }
+  err = RestrictSelf(ruleset_fd_, 0);
+  if (err) {
+    throw std::system_error(errno, std::generic_category(),
+                            "failed to apply ruleset");
+  }
+}
+
+int Ruleset::TryApply() const noexcept {
+  if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) ||
+      RestrictSelf(ruleset_fd_, 0)) {
+    return errno;
+  }
+  return 0;
+}
+
+} // namespace landlock
+} // namespace sandbox
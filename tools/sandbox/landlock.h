@@ -0,0 +1,254 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <linux/types.h>
+
+namespace sandbox {
+namespace landlock {
+/**
+ * struct landlock_ruleset_attr - Ruleset definition
+ *
+ * Argument of sys_landlock_create_ruleset().  This structure can grow in
+ * future versions.
+ */
+struct ruleset_attr {
+  /**
+   * @handled_access_fs: Bitmask of actions (cf. `Filesystem flags`_)
+   * that is handled by this ruleset and should then be forbidden if no
+   * rule explicitly allow them.  This is needed for backward
+   * compatibility reasons.
+   */
+  __u64 handled_access_fs;
+  /**
+   * @handled_access_net: Bitmask of network actions (cf. `Network flags`_)
+   * that is handled by this ruleset and should then be forbidden if no
+   * rule explicitly allow them.  Requires ABI version 4.
+   */
+  __u64 handled_access_net;
+};
+
+/**
+ * enum landlock_rule_type - Landlock rule type
+ *
+ * Argument of sys_landlock_add_rule().
+ */
+enum class rule_type {
+  /**
+   * @RULE_PATH_BENEATH: Type of a &struct
+   * landlock_path_beneath_attr .
+   */
+  RULE_PATH_BENEATH = 1,
+  /**
+   * @RULE_NET_PORT: Type of a &struct landlock_net_port_attr .
+   */
+  RULE_NET_PORT = 2,
+};
+
+/**
+ * struct landlock_path_beneath_attr - Path hierarchy definition
+ *
+ * Argument of sys_landlock_add_rule().
+ */
+struct path_beneath_attr {
+  /**
+   * @allowed_access: Bitmask of allowed actions for this file hierarchy
+   * (cf. `Filesystem flags`_).
+   */
+  __u64 allowed_access;
+  /**
+   * @parent_fd: File descriptor, open with ``O_PATH``, which identifies
+   * the parent directory of a file hierarchy, or just a file.
+   */
+  __s32 parent_fd;
+  /*
+   * This struct is packed to avoid trailing reserved members.
+   * Cf. security/landlock/syscalls.c:build_check_abi()
+   */
+} __attribute__((__packed__));
+
+/* Thin wrappers around the landlock syscalls. */
+int CreateRuleset(const struct ruleset_attr *const attr, const size_t size,
+                  const uint32_t flags);
+int AddRule(const int ruleset_fd, const enum rule_type rule_type,
+            const void *const rule_attr, const uint32_t flags);
+int RestrictSelf(const int ruleset_fd, const uint32_t flags);
+
+/* The ABI version for landlock, see Probe(). */
+int ABIVersion();
+
+/* If landlock is enabled. */
+bool Enabled();
+
+/* If the kernel can keep programs off the network (ABI >= 4). */
+bool CanRestrictNetwork();
+
+/* The network access rights of ABI version 4, TCP only. */
+struct NetAccess {
+  enum Value : uint64_t {
+    BIND_TCP = (1ULL << 0),
+    CONNECT_TCP = (1ULL << 1),
+  };
+};
+
+class FSAccess {
+public:
+  enum Value : uint64_t {
+    EXECUTE = (1ULL << 0),
+    WRITE_FILE = (1ULL << 1),
+    READ_FILE = (1ULL << 2),
+    READ_DIR = (1ULL << 3),
+    REMOVE_DIR = (1ULL << 4),
+    REMOVE_FILE = (1ULL << 5),
+    MAKE_CHAR = (1ULL << 6),
+    MAKE_DIR = (1ULL << 7),
+    MAKE_REG = (1ULL << 8),
+    MAKE_SOCK = (1ULL << 9),
+    MAKE_FIFO = (1ULL << 10),
+    MAKE_BLOCK = (1ULL << 11),
+    MAKE_SYM = (1ULL << 12),
+    REFER = (1ULL << 13),
+    TRUNCATE = (1ULL << 14),
+    IOCTL_DEV = (1ULL << 15),
+  };
+
+  FSAccess() = default;
+  constexpr FSAccess(uint64_t v) : value_(v) {}
+  constexpr FSAccess(Value v) : value_(v) {}
+
+  // Every right of the masks below, regardless of what the kernel supports.
+  static constexpr uint64_t kReadonly = EXECUTE | READ_FILE | READ_DIR;
+  static constexpr uint64_t kAllFile =
+      EXECUTE | WRITE_FILE | READ_FILE | TRUNCATE | IOCTL_DEV;
+  static constexpr uint64_t kAllDir = READ_DIR | REMOVE_DIR | REMOVE_FILE |
+                                      MAKE_CHAR | MAKE_DIR | MAKE_REG |
+                                      MAKE_SOCK | MAKE_FIFO | MAKE_BLOCK |
+                                      MAKE_SYM | REFER;
+
+  // The masks below are limited to what the running kernel supports, see
+  // Probe().
+  static FSAccess Readonly();
+  static FSAccess AllFile();
+  static FSAccess AllDir();
+  static FSAccess All() { return AllFile() | AllDir(); }
+
+  constexpr bool operator==(FSAccess a) const { return value_ == a.value_; }
+  constexpr bool operator!=(FSAccess a) const { return value_ != a.value_; }
+  constexpr FSAccess operator|(FSAccess a) const { return value_ | a.value_; }
+  constexpr FSAccess operator&(FSAccess a) const { return value_ & a.value_; }
+  constexpr uint64_t Value() const { return value_; }
+
+private:
+  uint64_t value_;
+};
+
+/*
+ * The landlock features of a kernel ABI version.
+ *
+ * Every version only adds access rights, so these are fully determined by the
+ * version and can be computed at compile time.
+ */
+struct Capabilities {
+  int abi = 0;
+  /* Every filesystem access right the kernel knows about. */
+  uint64_t handled_access_fs = 0;
+  /* Every network access right the kernel knows about (ABI >= 4). */
+  uint64_t handled_access_net = 0;
+
+  static constexpr Capabilities ForABI(int abi) {
+    Capabilities caps;
+    if (abi < 1) {
+      return caps;
+    }
+    caps.abi = abi;
+    // EXECUTE through MAKE_SYM.
+    caps.handled_access_fs = (FSAccess::MAKE_SYM << 1) - 1;
+    if (abi >= 2) {
+      caps.handled_access_fs |= FSAccess::REFER;
+    }
+    if (abi >= 3) {
+      caps.handled_access_fs |= FSAccess::TRUNCATE;
+    }
+    if (abi >= 4) {
+      caps.handled_access_net = NetAccess::BIND_TCP | NetAccess::CONNECT_TCP;
+    }
+    if (abi >= 5) {
+      caps.handled_access_fs |= FSAccess::IOCTL_DEV;
+    }
+    return caps;
+  }
+
+  constexpr bool Enabled() const { return abi > 0; }
+};
+
+/*
+ * The capabilities of the running kernel. The kernel is only asked on the
+ * first call, so this is cheap to call from anywhere.
+ */
+const Capabilities &Probe();
+
+class Ruleset {
+public:
+  Ruleset(const Ruleset &) = delete;
+  Ruleset(Ruleset &&other);
+  Ruleset &operator=(const Ruleset &) = delete;
+  Ruleset &operator=(Ruleset &&) = delete;
+  // Closes the ruleset, a process it was applied to stays restricted.
+  ~Ruleset();
+
+  /*
+   * With `deny_network`, the ruleset also handles the network rights the
+   * kernel supports, and since no port is ever allowed, the program can
+   * neither bind nor connect TCP sockets. On kernels before ABI version 4
+   * the network is left alone, see CanRestrictNetwork().
+   */
+  static Ruleset Create(bool deny_network = false);
+
+  /*
+   * Takes ownership of the descriptor of an existing ruleset with
+   * `rule_count` rules, e.g. one passed from another process. Rulesets are
+   * shared between all descriptors, so one that is shared must not be
+   * extended anymore.
+   */
+  static Ruleset Adopt(int ruleset_fd, int rule_count) {
+    Ruleset ruleset(ruleset_fd);
+    ruleset.rule_count_ = rule_count;
+    return ruleset;
+  }
+
+  /*
+   * Populates the landlock ruleset for a path and any needed paths beneath.
+   * Missing paths are skipped, and for files the directory rights are
+   * dropped since the kernel rejects them.
+   */
+  void Allow(const std::filesystem::path path, const FSAccess allowed_access);
+
+  /*
+   * Same as Allow, but for a path that has already been opened with O_PATH.
+   * The descriptor is not closed, and `allowed_access` must already suit the
+   * type of file.
+   */
+  void AllowFd(int path_fd, const FSAccess allowed_access);
+
+  void Apply();
+
+  /*
+   * Same as Apply, but returns the errno instead of throwing. It makes
+   * nothing but syscalls, so it is safe in a child that shares the memory of
+   * its parent (see SpawnExec).
+   */
+  int TryApply() const noexcept;
+
+  // The number of rules added so far.
+  int RuleCount() const { return rule_count_; }
+  int Fd() const { return ruleset_fd_; }
+
+private:
+  explicit Ruleset(int ruleset_fd) : ruleset_fd_(ruleset_fd) {}
+
+  int ruleset_fd_;
+  int rule_count_ = 0;
+};
+} // namespace landlock
+} // namespace sandbox
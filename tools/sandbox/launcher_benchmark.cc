@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <spawn.h>
+#include <string>
+#include <string_view>
+#include <sys/wait.h>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <absl/strings/str_split.h>
+#include <fmt/format.h>
+
+#include "sandbox/cache.h"
+#include "sandbox/policy.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr std::string_view kUsage =
+    "Measures the launch latency of process wrappers, usage:\n"
+    "./launcher_benchmark [--runs=N] [--rules=0,10,1000,10000] [--jobs=N]\n"
+    "                     [--scratch=DIR] <wrapper>...\n\n"
+    "Every wrapper runs `/bin/true` N times (default 500) after a few warm up\n"
+    "runs, once for every number of rules. The rules are files in a scratch\n"
+    "directory (default $TMPDIR or /tmp), passed as a compiled policy. With\n"
+    "--jobs, that many launches run concurrently, which shows contention in\n"
+    "the kernel (path lookups, landlock ruleset creation, exec) as a growing\n"
+    "tail.\n\n"
+    "The percentiles of the time from the spawn until the wrapper exits are\n"
+    "printed per launch. The first row is `/bin/true` on its own, the cost of\n"
+    "the exec that every wrapper pays on top of its own startup.";
+
+constexpr int kWarmupRuns = 10;
+// Files per directory of the generated rules, about a large include
+// directory.
+constexpr int kFilesPerDirectory = 100;
+
+extern "C" char **environ;
+
+// Runs `args` and waits for it, returns the time it took.
+int64_t TimeRun(const std::vector<std::string> &args) {
+  std::vector<char *> c_args;
+  for (const auto &arg : args) {
+    c_args.push_back(const_cast<char *>(arg.c_str()));
+  }
+  c_args.push_back(nullptr);
+  auto start = std::chrono::steady_clock::now();
+  pid_t pid;
+  int err = posix_spawn(&pid, c_args[0], nullptr, nullptr, c_args.data(),
+                        environ);
+  if (err) {
+    throw std::system_error(err, std::generic_category(),
+                            fmt::format("failed to spawn {}", args[0]));
+  }
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) {
+      throw std::system_error(errno, std::generic_category(),
+                              "failed to wait for child");
+    }
+  }
+  auto end = std::chrono::steady_clock::now();
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    throw std::runtime_error(
+        fmt::format("{} failed with status {}", fmt::join(args, " "), status));
+  }
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+      .count();
+}
+
+// The `p`th percentile of sorted `samples`, in microseconds.
+double Percentile(const std::vector<int64_t> &samples, double p) {
+  size_t i = std::min(samples.size() - 1, size_t(p / 100 * samples.size()));
+  return samples[i] / 1000.0;
+}
+
+// Runs `args` `runs` times on each of `jobs` threads.
+void Report(std::string_view name, const std::vector<std::string> &args,
+            int runs, int jobs) {
+  std::vector<std::vector<int64_t>> per_job(jobs);
+  std::vector<std::exception_ptr> errors(jobs);
+  auto start = std::chrono::steady_clock::now();
+  {
+    std::vector<std::jthread> threads;
+    for (int job = 0; job < jobs; ++job) {
+      threads.emplace_back([&, job] {
+        try {
+          for (int i = 0; i < kWarmupRuns; ++i) {
+            TimeRun(args);
+          }
+          per_job[job].reserve(runs);
+          for (int i = 0; i < runs; ++i) {
+            per_job[job].push_back(TimeRun(args));
+          }
+        } catch (...) {
+          errors[job] = std::current_exception();
+        }
+      });
+    }
+  }
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  std::vector<int64_t> samples;
+  for (const auto &job_samples : per_job) {
+    samples.insert(samples.end(), job_samples.begin(), job_samples.end());
+  }
+  std::sort(samples.begin(), samples.end());
+  fmt::println("{:<40} {:>9.1f} {:>9.1f} {:>9.1f} {:>9.1f} {:>11.0f}", name,
+               Percentile(samples, 0), Percentile(samples, 50),
+               Percentile(samples, 90), Percentile(samples, 99),
+               (jobs * (runs + kWarmupRuns)) / seconds);
+}
+
+// Creates `count` readonly files under `dir` and compiles a policy for them.
+fs::path MakePolicy(const fs::path &dir, int count) {
+  std::vector<sandbox::PolicyEntry> entries;
+  entries.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    auto subdir = dir / fmt::format("rules_{}", count) /
+                  fmt::format("d{}", i / kFilesPerDirectory);
+    if (i % kFilesPerDirectory == 0) {
+      fs::create_directories(subdir);
+    }
+    auto file = subdir / fmt::format("f{}.h", i);
+    sandbox::WriteFileAtomic(file, "");
+    entries.push_back(
+        {.path = file, .access = sandbox::landlock::FSAccess::kReadonly});
+  }
+  auto policy = dir / fmt::format("rules_{}.policy", count);
+  sandbox::WritePolicy(policy, entries);
+  return policy;
+}
+
+bool ParseCount(std::string_view value, int *result) {
+  auto end = value.data() + value.size();
+  auto [ptr, ec] = std::from_chars(value.data(), end, *result);
+  return ec == std::errc() && ptr == end && *result >= 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int runs = 500;
+  int jobs = 1;
+  std::vector<int> rule_counts = {0, 10, 1000, 10000};
+  const char *tmpdir = getenv("TMPDIR");
+  fs::path scratch = tmpdir ? tmpdir : "/tmp";
+  std::vector<std::string> wrappers;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg = argv[i];
+    bool ok = true;
+    if (arg.starts_with("--runs=")) {
+      ok = ParseCount(arg.substr(7), &runs) && runs > 0;
+    } else if (arg.starts_with("--jobs=")) {
+      ok = ParseCount(arg.substr(7), &jobs) && jobs > 0;
+    } else if (arg.starts_with("--rules=")) {
+      rule_counts.clear();
+      for (std::string_view count : absl::StrSplit(arg.substr(8), ',')) {
+        ok = ok && ParseCount(count, &rule_counts.emplace_back());
+      }
+    } else if (arg.starts_with("--scratch=")) {
+      scratch = arg.substr(10);
+    } else if (arg.starts_with("-")) {
+      ok = false;
+    } else {
+      wrappers.emplace_back(arg);
+    }
+    if (!ok) {
+      fmt::println(stderr, "invalid argument: {}\n\n{}", arg, kUsage);
+      return 1;
+    }
+  }
+  if (wrappers.empty()) {
+    fmt::println(stderr, "{}", kUsage);
+    return 1;
+  }
+
+  fs::path dir;
+  try {
+    std::string dir_template = scratch / "launcher_benchmark.XXXXXX";
+    if (!mkdtemp(dir_template.data())) {
+      throw std::system_error(errno, std::generic_category(),
+                              fmt::format("failed to create a directory in {}",
+                                          scratch.native()));
+    }
+    dir = dir_template;
+    std::vector<fs::path> policies;
+    for (int count : rule_counts) {
+      policies.push_back(count ? MakePolicy(dir, count) : fs::path());
+    }
+
+    fmt::println("{} runs on {} jobs", runs, jobs);
+    fmt::println("{:<40} {:>9} {:>9} {:>9} {:>9} {:>11}",
+                 "launch latency (us)", "min", "p50", "p90", "p99",
+                 "launches/s");
+    Report("/bin/true", {"/bin/true"}, runs, jobs);
+    for (const auto &wrapper : wrappers) {
+      for (size_t i = 0; i < rule_counts.size(); ++i) {
+        std::vector<std::string> args = {wrapper};
+        if (!policies[i].empty()) {
+          args.push_back(fmt::format("--policy={}", policies[i].native()));
+        }
+        args.insert(args.end(), {"--", "/bin/true"});
+        Report(fmt::format("{} rules={}", fs::path(wrapper).filename().native(),
+                           rule_counts[i]),
+               args, runs, jobs);
+      }
+    }
+  } catch (const std::exception &ex) {
+    fmt::println(stderr, "{}", ex.what());
+    if (!dir.empty()) {
+      fs::remove_all(dir);
+    }
+    return 1;
+  }
+  fs::remove_all(dir);
+  return 0;
+}
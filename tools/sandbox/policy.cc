@@ -0,0 +1,262 @@
+#include "sandbox/policy.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+#include <absl/cleanup/cleanup.h>
+#include <fmt/format.h>
+
+#include "sandbox/ruleset_optimizer.h"
+#include "sandbox/sha256.h"
+
+namespace sandbox {
+namespace {
+
+constexpr char kPolicyMagic[8] = {'L', 'L', 'P', 'O', 'L', 'I', 'C', 'Y'};
+constexpr uint32_t kPolicyVersion = 2;
+
+PolicyRule::Type TypeOf(const std::filesystem::path &path) {
+  struct stat st;
+  if (stat(path.native().c_str(), &st)) {
+    return PolicyRule::UNKNOWN;
+  }
+  return S_ISDIR(st.st_mode) ? PolicyRule::DIRECTORY : PolicyRule::FILE;
+}
+
+void WriteAll(int fd, const void *data, size_t size) {
+  const auto *bytes = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t n = write(fd, bytes, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(),
+                              "failed to write policy");
+    }
+    bytes += n;
+    size -= n;
+  }
+}
+
+} // namespace
+
+void WritePolicy(const std::filesystem::path &output,
+                 std::span<const PolicyEntry> entries,
+                 std::span<const PolicyEntry> implied) {
+  std::vector<PolicyEntry> typed(entries.begin(), entries.end());
+  for (auto &entry : typed) {
+    entry.type = TypeOf(entry.path);
+    if (entry.type == PolicyRule::FILE) {
+      entry.access = entry.access & landlock::FSAccess::kAllFile;
+    }
+  }
+  auto optimized = OptimizeRules(typed, implied);
+
+  std::vector<PolicyRule> rules;
+  rules.reserve(optimized.size());
+  std::string strings;
+  for (const auto &entry : optimized) {
+    PolicyRule rule = {
+        .access = entry.access.Value(),
+        .path_offset = static_cast<uint32_t>(strings.size()),
+        .type = entry.type,
+    };
+    rules.push_back(rule);
+    strings.append(entry.path.native());
+    strings.push_back('\0');
+  }
+  PolicyHeader header = {
+      .magic = {},
+      .version = kPolicyVersion,
+      .rule_count = static_cast<uint32_t>(rules.size()),
+      .strings_size = strings.size(),
+      .graph_hash = {},
+  };
+  std::memcpy(header.magic, kPolicyMagic, sizeof(header.magic));
+  Sha256 hash;
+  hash.Update(rules.data(), rules.size() * sizeof(PolicyRule));
+  hash.Update(strings);
+  auto digest = hash.HexDigest();
+  std::memcpy(header.graph_hash, digest.data(), sizeof(header.graph_hash));
+
+  // Write to a temporary and rename, so a concurrent reader never sees a
+  // partial policy.
+  auto tmp = output;
+  tmp += fmt::format(".tmp{}", getpid());
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            fmt::format("failed to create {}", tmp.native()));
+  }
+  {
+    auto fd_cleanup = absl::MakeCleanup([fd] { close(fd); });
+    WriteAll(fd, &header, sizeof(header));
+    WriteAll(fd, rules.data(), rules.size() * sizeof(PolicyRule));
+    WriteAll(fd, strings.data(), strings.size());
+  }
+  std::filesystem::rename(tmp, output);
+}
+
+Policy::Policy(Policy &&other)
+    : data_(other.data_), size_(other.size_), rules_(other.rules_),
+      strings_(other.strings_) {
+  other.data_ = nullptr;
+  other.size_ = 0;
+}
+
+Policy::~Policy() {
+  if (data_) {
+    munmap(data_, size_);
+  }
+}
+
+Policy Policy::Map(const std::filesystem::path &path) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::system_error(
+        errno, std::generic_category(),
+        fmt::format("failed to open policy: {}", path.native()));
+  }
+  auto fd_cleanup = absl::MakeCleanup([fd] { close(fd); });
+  struct stat st;
+  if (fstat(fd, &st)) {
+    throw std::system_error(
+        errno, std::generic_category(),
+        fmt::format("failed to stat policy: {}", path.native()));
+  }
+  size_t size = st.st_size;
+  auto malformed = [&path](std::string_view why) {
+    return std::runtime_error(
+        fmt::format("malformed policy {}: {}", path.native(), why));
+  };
+  if (size < sizeof(PolicyHeader)) {
+    throw malformed("too small");
+  }
+  void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    throw std::system_error(
+        errno, std::generic_category(),
+        fmt::format("failed to map policy: {}", path.native()));
+  }
+  // Owns the mapping from here on, so it's released if validation fails.
+  Policy policy(data, size, {}, nullptr);
+
+  const auto *bytes = static_cast<const char *>(data);
+  const auto *header = reinterpret_cast<const PolicyHeader *>(bytes);
+  if (std::memcmp(header->magic, kPolicyMagic, sizeof(kPolicyMagic)) ||
+      header->version != kPolicyVersion) {
+    throw malformed("unknown format");
+  }
+  size_t rules_size = size_t{header->rule_count} * sizeof(PolicyRule);
+  if (size - sizeof(PolicyHeader) < rules_size ||
+      size - sizeof(PolicyHeader) - rules_size != header->strings_size) {
+    throw malformed("truncated");
+  }
+  const char *strings = bytes + sizeof(PolicyHeader) + rules_size;
+  if (header->strings_size > 0 && strings[header->strings_size - 1] != '\0') {
+    throw malformed("unterminated path");
+  }
+  std::span<const PolicyRule> rules(
+      reinterpret_cast<const PolicyRule *>(bytes + sizeof(PolicyHeader)),
+      header->rule_count);
+  for (const auto &rule : rules) {
+    if (rule.path_offset >= header->strings_size) {
+      throw malformed("path out of bounds");
+    }
+  }
+  policy.rules_ = rules;
+  policy.strings_ = strings;
+  return policy;
+}
+
+void Policy::AllowAll(landlock::Ruleset *ruleset) const {
+  // Policies are sorted by path, so consecutive rules mostly share their
+  // directory. The open directories of the current path are kept, and each
+  // rule is opened relative to its own directory with a single path element,
+  // rather than resolving every path from the root.
+  std::vector<std::pair<std::string_view, int>> dirs;
+  auto dirs_cleanup = absl::MakeCleanup([&dirs] {
+    for (const auto &[dir, fd] : dirs) {
+      close(fd);
+    }
+  });
+  for (const auto &rule : rules_) {
+    std::string_view path = Path(rule);
+    auto slash = path.rfind('/');
+    if (slash == std::string_view::npos || slash + 1 == path.size()) {
+      // Not written by WritePolicy, take the slow path.
+      AllowPath(ruleset, rule, AT_FDCWD, Path(rule));
+      continue;
+    }
+    auto dir = path.substr(0, slash);
+    auto name = path.substr(slash + 1);
+    while (!dirs.empty() && dirs.back().first != dir &&
+           !(dir.starts_with(dirs.back().first) &&
+             dir[dirs.back().first.size()] == '/')) {
+      close(dirs.back().second);
+      dirs.pop_back();
+    }
+    if (dirs.empty() || dirs.back().first != dir) {
+      int base_fd = dirs.empty() ? AT_FDCWD : dirs.back().second;
+      // Relative to the closest open parent, the root directory is the
+      // empty string.
+      std::string relative;
+      if (!dirs.empty()) {
+        relative = dir.substr(dirs.back().first.size() + 1);
+      } else if (dir.empty()) {
+        relative = "/";
+      } else {
+        relative = dir;
+      }
+      int fd = openat(base_fd, relative.c_str(),
+                      O_PATH | O_DIRECTORY | O_CLOEXEC);
+      if (fd < 0) {
+        if (errno == ENOENT) {
+          continue;
+        }
+        throw std::system_error(
+            errno, std::generic_category(),
+            fmt::format("failed to open directory: {}", dir));
+      }
+      dirs.emplace_back(dir, fd);
+    }
+    AllowPath(ruleset, rule, dirs.back().second, std::string(name).c_str());
+  }
+}
+
+void Policy::AllowPath(landlock::Ruleset *ruleset, const PolicyRule &rule,
+                       int dir_fd, const char *name) const {
+  int fd = openat(dir_fd, name, O_PATH | O_CLOEXEC);
+  if (fd < 0) {
+    if (errno == ENOENT) {
+      return;
+    }
+    throw std::system_error(errno, std::generic_category(),
+                            fmt::format("failed to open path: {}", Path(rule)));
+  }
+  auto fd_cleanup = absl::MakeCleanup([fd] { close(fd); });
+  auto type = rule.type;
+  if (type == PolicyRule::UNKNOWN) {
+    struct stat st;
+    if (fstat(fd, &st)) {
+      throw std::system_error(
+          errno, std::generic_category(),
+          fmt::format("failed to stat path: {}", Path(rule)));
+    }
+    type = S_ISDIR(st.st_mode) ? PolicyRule::DIRECTORY : PolicyRule::FILE;
+  }
+  auto access = landlock::FSAccess(rule.access) &
+                (type == PolicyRule::FILE ? landlock::FSAccess::AllFile()
+                                          : landlock::FSAccess::All());
+  ruleset->AllowFd(fd, access);
+}
+
+} // namespace sandbox
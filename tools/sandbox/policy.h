@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sandbox/landlock.h"
+
+namespace sandbox {
+
+// A precompiled sandbox policy, the binary equivalent of a list of
+// --ro_dirs/--rw_dirs/--ro_paths/--rw_paths flags.
+//
+// Policies are written once per target at build time (see
+// sandbox_policy_compiler) and mapped by the wrapper with a single mmap, the
+// paths are handed to the kernel straight out of the mapping.
+//
+// Layout, in host byte order:
+//   PolicyHeader
+//   PolicyRule[rule_count]
+//   char strings[strings_size]  (NUL terminated paths)
+struct PolicyHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t rule_count;
+  uint64_t strings_size;
+  // Hex SHA-256 of the rules and the strings. They are the files the
+  // target's dependency graph allows, so this only changes when the graph
+  // does (see RulesetCache).
+  char graph_hash[64];
+};
+
+struct PolicyRule {
+  // FSAccess bits, regardless of kernel support, they are masked on load.
+  uint64_t access;
+  // Offset of the path in the string table.
+  uint32_t path_offset;
+  // PolicyRule::Type
+  uint32_t type;
+
+  enum Type : uint32_t {
+    // The path did not exist when the policy was compiled (e.g. a generated
+    // file), the type is checked when the policy is applied.
+    UNKNOWN = 0,
+    DIRECTORY = 1,
+    // Files only accept the file rights, so those rules are never given any
+    // directory rights.
+    FILE = 2,
+  };
+};
+
+// A rule before compilation.
+struct PolicyEntry {
+  std::filesystem::path path;
+  landlock::FSAccess access;
+  // Filled in by WritePolicy.
+  PolicyRule::Type type = PolicyRule::UNKNOWN;
+};
+
+// Serializes `entries`, checking each path's type on the way. The rules are
+// reduced with OptimizeRules first, `implied` are rules the wrapper always
+// adds (see AutomaticEntries), they are not written. Throws on failure.
+void WritePolicy(const std::filesystem::path &output,
+                 std::span<const PolicyEntry> entries,
+                 std::span<const PolicyEntry> implied = {});
+
+class Policy {
+public:
+  Policy(const Policy &) = delete;
+  Policy(Policy &&other);
+  Policy &operator=(const Policy &) = delete;
+  Policy &operator=(Policy &&) = delete;
+  ~Policy();
+
+  // Maps a policy file, throws if it can't be read or is malformed.
+  static Policy Map(const std::filesystem::path &path);
+
+  std::span<const PolicyRule> Rules() const { return rules_; }
+  const char *Path(const PolicyRule &rule) const {
+    return strings_ + rule.path_offset;
+  }
+  std::string_view GraphHash() const {
+    const auto *header = static_cast<const PolicyHeader *>(data_);
+    return {header->graph_hash, sizeof(header->graph_hash)};
+  }
+
+  // Adds every rule to `ruleset`, paths that don't exist are skipped.
+  void AllowAll(landlock::Ruleset *ruleset) const;
+
+private:
+  // Opens `name` relative to `dir_fd` and adds `rule` for it.
+  void AllowPath(landlock::Ruleset *ruleset, const PolicyRule &rule,
+                 int dir_fd, const char *name) const;
+
+  Policy(void *data, size_t size, std::span<const PolicyRule> rules,
+         const char *strings)
+      : data_(data), size_(size), rules_(rules), strings_(strings) {}
+
+  void *data_;
+  size_t size_;
+  std::span<const PolicyRule> rules_;
+  const char *strings_;
+};
+
+} // namespace sandbox
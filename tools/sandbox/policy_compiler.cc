@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <absl/strings/strip.h>
+#include <fmt/core.h>
+
+#include "sandbox/landlock.h"
+#include "sandbox/policy.h"
+#include "sandbox/sandbox.h"
+
+namespace {
+
+using sandbox::landlock::FSAccess;
+
+constexpr std::string_view kUsage =
+    "Compiles a sandbox policy for process_wrapper --policy, usage:\n"
+    "./policy_compiler <rules.txt> <output.policy>\n\n"
+    "Every line of the rules is \"<flag> <path>\", where flag is one of\n"
+    "ro_dirs, rw_dirs, ro_paths or rw_paths with the same meaning as the\n"
+    "process_wrapper flags. Empty lines and lines starting with # are "
+    "ignored.";
+
+// The same rights the wrapper grants for the flag, before masking them with
+// what the kernel supports.
+bool AccessForFlag(std::string_view flag, FSAccess *access) {
+  if (flag == "ro_dirs") {
+    *access = FSAccess::kAllDir & FSAccess::kReadonly;
+  } else if (flag == "rw_dirs") {
+    *access = FSAccess::kAllDir;
+  } else if (flag == "ro_paths") {
+    *access = FSAccess::kReadonly;
+  } else if (flag == "rw_paths") {
+    *access = FSAccess::kAllDir | FSAccess::kAllFile;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fmt::println(stderr, "{}", kUsage);
+    return 1;
+  }
+  std::ifstream input(argv[1]);
+  if (!input) {
+    fmt::println(stderr, "failed to open {}", argv[1]);
+    return 1;
+  }
+  std::vector<sandbox::PolicyEntry> entries;
+  std::string line;
+  for (int lineno = 1; std::getline(input, line); ++lineno) {
+    std::string_view rest = absl::StripAsciiWhitespace(line);
+    if (rest.empty() || rest.starts_with('#')) {
+      continue;
+    }
+    auto space = rest.find(' ');
+    FSAccess access;
+    if (space == std::string_view::npos ||
+        !AccessForFlag(rest.substr(0, space), &access)) {
+      fmt::println(stderr, "{}:{}: invalid rule: \"{}\"", argv[1], lineno,
+                   rest);
+      return 1;
+    }
+    entries.push_back({
+        .path = std::string(absl::StripLeadingAsciiWhitespace(
+            rest.substr(space + 1))),
+        .access = access,
+    });
+  }
+  try {
+    // The wrapper grants the automatic paths anyway, rules below them (e.g.
+    // for /usr/include) are left out. Not below /tmp though, which isn't
+    // granted with --private_tmp.
+    sandbox::WritePolicy(argv[2], entries,
+                         sandbox::AutomaticEntries(/*tmp=*/false));
+  } catch (const std::exception &ex) {
+    fmt::println(stderr, "{}", ex.what());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,210 @@
+#include "sandbox/ruleset_cache.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include "sandbox/sha256.h"
+
+namespace sandbox {
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr uint32_t kOfferMagic = 0x4c4c5243; // "LLRC"
+
+// Every child holds the descriptors of all entries until it execs, so stay
+// well below the usual limit of 1024 open files.
+constexpr size_t kMaxEntries = 256;
+
+// An offer from a child, sent along with the ruleset's descriptor.
+struct OfferMessage {
+  uint32_t magic;
+  int32_t rule_count;
+  char key[64];
+};
+
+std::string_view Parent(std::string_view path) {
+  auto slash = path.rfind('/');
+  if (slash == std::string_view::npos) {
+    return ".";
+  }
+  return path.substr(0, slash == 0 ? 1 : slash);
+}
+
+// Adding, removing or renaming an entry of a directory updates its mtime.
+void HashDirectory(std::string_view dir, Sha256 *hash) {
+  std::string path(dir);
+  struct stat st;
+  if (stat(path.c_str(), &st)) {
+    hash->Update(fmt::format("dir {} missing", path));
+  } else {
+    hash->Update(fmt::format("dir {} {} {} {}.{}", path, st.st_dev, st.st_ino,
+                             st.st_mtim.tv_sec, st.st_mtim.tv_nsec));
+  }
+  hash->Update("\0", 1);
+}
+
+} // namespace
+
+RulesetCache::RulesetCache(RulesetCache &&other)
+    : receive_fd_(std::exchange(other.receive_fd_, -1)),
+      send_fd_(std::exchange(other.send_fd_, -1)),
+      entries_(std::exchange(other.entries_, {})) {}
+
+RulesetCache::~RulesetCache() {
+  for (const auto &[key, entry] : entries_) {
+    close(entry.fd);
+  }
+  if (receive_fd_ >= 0) {
+    close(receive_fd_);
+  }
+  if (send_fd_ >= 0) {
+    close(send_fd_);
+  }
+}
+
+RulesetCache RulesetCache::Create() {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, fds)) {
+    throw std::system_error(errno, std::generic_category(),
+                            "failed to create ruleset cache socket");
+  }
+  return RulesetCache(fds[0], fds[1]);
+}
+
+std::string RulesetCache::Key(const ParsedArgs &parsed, const Policy *policy) {
+  Sha256 hash;
+  hash.Update(fs::current_path().native());
+  hash.Update("\0", 1);
+  if (parsed.deny_network) {
+    hash.Update("deny_network");
+    hash.Update("\0", 1);
+  }
+  auto add = [&hash](std::string_view flag, const fs::path &path) {
+    hash.Update(fmt::format("{} {}", flag, path.native()));
+    hash.Update("\0", 1);
+    HashDirectory(Parent(path.native()), &hash);
+  };
+  for (const auto &p : parsed.ro_dirs) {
+    add("ro_dir", p);
+  }
+  for (const auto &p : parsed.rw_dirs) {
+    add("rw_dir", p);
+  }
+  for (const auto &p : parsed.ro_paths) {
+    add("ro_path", p);
+  }
+  for (const auto &p : parsed.rw_paths) {
+    add("rw_path", p);
+  }
+  if (policy) {
+    hash.Update(fmt::format("policy {}", policy->GraphHash()));
+    hash.Update("\0", 1);
+    // Rules are sorted by path, so siblings are mostly next to each other.
+    std::string_view last;
+    for (const auto &rule : policy->Rules()) {
+      auto dir = Parent(policy->Path(rule));
+      if (dir != last) {
+        HashDirectory(dir, &hash);
+        last = dir;
+      }
+    }
+  }
+  return hash.HexDigest();
+}
+
+std::optional<landlock::Ruleset>
+RulesetCache::Find(const std::string &key) const {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return std::nullopt;
+  }
+  int fd = fcntl(it->second.fd, F_DUPFD_CLOEXEC, 0);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+  return landlock::Ruleset::Adopt(fd, it->second.rule_count);
+}
+
+void RulesetCache::Offer(const std::string &key,
+                         const landlock::Ruleset &ruleset) const {
+  OfferMessage offer = {
+      .magic = kOfferMagic, .rule_count = ruleset.RuleCount(), .key = {}};
+  if (key.size() != sizeof(offer.key)) {
+    return;
+  }
+  std::memcpy(offer.key, key.data(), sizeof(offer.key));
+  iovec iov = {.iov_base = &offer, .iov_len = sizeof(offer)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  int fd = ruleset.Fd();
+  std::memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+  // A full socket only costs the next compile a rebuild.
+  while (sendmsg(send_fd_, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 &&
+         errno == EINTR) {
+  }
+}
+
+void RulesetCache::Receive() {
+  while (true) {
+    OfferMessage offer;
+    iovec iov = {.iov_base = &offer, .iov_len = sizeof(offer)};
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t n = recvmsg(receive_fd_, &msg, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int))) {
+      continue;
+    }
+    int fd;
+    std::memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+    std::string key(offer.key, sizeof(offer.key));
+    if (n != sizeof(offer) || offer.magic != kOfferMagic ||
+        entries_.contains(key)) {
+      close(fd);
+      continue;
+    }
+    // Edits leave stale entries behind that are never found again, so
+    // starting over is as good as any eviction.
+    if (entries_.size() >= kMaxEntries) {
+      for (const auto &[stale_key, entry] : entries_) {
+        close(entry.fd);
+      }
+      entries_.clear();
+    }
+    entries_.emplace(std::move(key),
+                     Entry{.fd = fd, .rule_count = offer.rule_count});
+  }
+}
+
+} // namespace sandbox
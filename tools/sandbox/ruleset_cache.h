@@ -0,0 +1,66 @@
+#pragma once
+
+#include <map>
+#include <optional>
+#include <string>
+
+#include "sandbox/args.h"
+#include "sandbox/landlock.h"
+#include "sandbox/policy.h"
+
+namespace sandbox {
+
+// Rulesets built by the children of a fork server, kept by the server so the
+// next compile of the same target applies them instead of adding every rule
+// again.
+//
+// A child that misses builds the ruleset as usual and passes its descriptor
+// to the server over a socket, later children inherit the server's entries
+// when they are forked. Entries are keyed by the sandbox flags, the graph
+// hash of the policy (see PolicyHeader) and the inode and mtime of every
+// directory holding a rule. A rule refers to the inode that was opened, so a
+// header replaced by a rename, a missing file that appeared or a change of the
+// target's DEPS make a new key, and only that target's ruleset is rebuilt.
+class RulesetCache {
+public:
+  RulesetCache(const RulesetCache &) = delete;
+  RulesetCache(RulesetCache &&other);
+  RulesetCache &operator=(const RulesetCache &) = delete;
+  RulesetCache &operator=(RulesetCache &&) = delete;
+  ~RulesetCache();
+
+  // Creates an empty cache, throws on failure.
+  static RulesetCache Create();
+
+  // The key of the ruleset BuildSandbox makes for `parsed` with the already
+  // mapped `policy` (null without --policy).
+  static std::string Key(const ParsedArgs &parsed, const Policy *policy);
+
+  // The cached ruleset for `key`, it is shared and must not be extended.
+  std::optional<landlock::Ruleset> Find(const std::string &key) const;
+
+  // Offers `ruleset` to the server, best effort. The ruleset must not be
+  // extended afterwards.
+  void Offer(const std::string &key, const landlock::Ruleset &ruleset) const;
+
+  // The descriptor the server polls for offers.
+  int ReceiveFd() const { return receive_fd_; }
+
+  // Adds the pending offers, on the server.
+  void Receive();
+
+private:
+  struct Entry {
+    int fd;
+    int rule_count;
+  };
+
+  RulesetCache(int receive_fd, int send_fd)
+      : receive_fd_(receive_fd), send_fd_(send_fd) {}
+
+  int receive_fd_;
+  int send_fd_;
+  std::map<std::string, Entry> entries_;
+};
+
+} // namespace sandbox
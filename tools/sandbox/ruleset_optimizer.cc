@@ -0,0 +1,72 @@
+#include "sandbox/ruleset_optimizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <system_error>
+
+namespace sandbox {
+namespace {
+
+namespace fs = std::filesystem;
+
+struct Node {
+  uint64_t access = 0;
+  uint64_t implied = 0;
+  PolicyRule::Type type = PolicyRule::UNKNOWN;
+};
+
+fs::path Canonical(const fs::path &path) {
+  std::error_code ec;
+  auto canonical = fs::weakly_canonical(fs::absolute(path), ec);
+  if (ec) {
+    return fs::absolute(path).lexically_normal();
+  }
+  return canonical;
+}
+
+bool IsBeneath(const fs::path &parent, const fs::path &path) {
+  auto [p, c] = std::mismatch(parent.begin(), parent.end(), path.begin(),
+                              path.end());
+  // A trailing separator shows up as an empty element.
+  return p == parent.end() || (std::next(p) == parent.end() && p->empty());
+}
+
+} // namespace
+
+std::vector<PolicyEntry> OptimizeRules(std::span<const PolicyEntry> entries,
+                                       std::span<const PolicyEntry> implied) {
+  // Ordering paths element by element walks the tree of rules depth first,
+  // every path comes right after the paths it is beneath.
+  std::map<fs::path, Node> nodes;
+  for (const auto &entry : implied) {
+    nodes[Canonical(entry.path)].implied |= entry.access.Value();
+  }
+  for (const auto &entry : entries) {
+    auto &node = nodes[Canonical(entry.path)];
+    node.access |= entry.access.Value();
+    if (node.type == PolicyRule::UNKNOWN) {
+      node.type = entry.type;
+    }
+  }
+
+  std::vector<PolicyEntry> optimized;
+  // The open parents and the access granted at each of them.
+  std::vector<std::pair<const fs::path *, uint64_t>> parents;
+  for (const auto &[path, node] : nodes) {
+    while (!parents.empty() && !IsBeneath(*parents.back().first, path)) {
+      parents.pop_back();
+    }
+    uint64_t inherited = parents.empty() ? 0 : parents.back().second;
+    uint64_t granted = inherited | node.implied;
+    if (node.access & ~granted) {
+      optimized.push_back(
+          {.path = path, .access = node.access, .type = node.type});
+    }
+    parents.emplace_back(&path, granted | node.access);
+  }
+  return optimized;
+}
+
+} // namespace sandbox
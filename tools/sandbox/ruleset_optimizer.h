@@ -0,0 +1,26 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "sandbox/policy.h"
+
+namespace sandbox {
+
+// Returns the smallest list of rules that grants the same access as
+// `entries`, given that the `implied` rules are granted anyway.
+//
+// Path beneath rules apply to everything below them, so a rule is dropped if
+// its parent directories (or implied rules) already grant all of its access,
+// and rules for the same path are merged into one. This is what keeps
+// generated header lists with hundreds of files below a single include root
+// from costing an open and a landlock_add_rule each.
+//
+// Paths are compared the way the kernel sees them: made absolute and with
+// symlinks resolved, so a symlink below a directory rule that points
+// elsewhere keeps its own rule. Paths that don't exist are only normalized.
+std::vector<PolicyEntry>
+OptimizeRules(std::span<const PolicyEntry> entries,
+              std::span<const PolicyEntry> implied = {});
+
+} // namespace sandbox
@@ -0,0 +1,356 @@
+#include "sandbox/run.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "sandbox/audit.h"
+#include "sandbox/capture.h"
+#include "sandbox/exec.h"
+#include "sandbox/fork_server.h"
+#include "sandbox/landlock.h"
+#include "sandbox/stats.h"
+
+namespace sandbox {
+namespace {
+
+namespace fs = std::filesystem;
+
+// Lines of a failed program's output shown when the rest goes to
+// --output_log, usually enough for the first error.
+constexpr size_t kOutputLogHeadLines = 20;
+
+// The directory of a --private_tmp program, removed with everything in it
+// once the program is done, also if the wrapper is interrupted (see
+// ForwardSignals). Only this directory is created and removed in
+// the shared TMPDIR, the program's own temporary files don't contend with
+// other programs there, and can't collide with theirs.
+class PrivateTmp {
+public:
+  // Creates a new directory below the TMPDIR of `envp` (default /tmp),
+  // throws on failure.
+  explicit PrivateTmp(char **envp);
+  PrivateTmp(const PrivateTmp &) = delete;
+  PrivateTmp &operator=(const PrivateTmp &) = delete;
+  ~PrivateTmp();
+
+  const fs::path &Path() const { return path_; }
+
+  // The environment with TMPDIR set to the directory.
+  char **Env() { return env_.data(); }
+
+private:
+  fs::path path_;
+  std::vector<std::string> strings_;
+  std::vector<char *> env_;
+};
+
+PrivateTmp::PrivateTmp(char **envp) {
+  std::string base = "/tmp";
+  for (char **env = envp; *env; ++env) {
+    std::string_view var = *env;
+    if (var.starts_with("TMPDIR=")) {
+      if (var.size() > 7) {
+        base = var.substr(7);
+      }
+    } else {
+      strings_.emplace_back(var);
+    }
+  }
+  std::string name = fmt::format("{}/sandbox.XXXXXX", base);
+  if (!mkdtemp(name.data())) {
+    throw std::system_error(
+        errno, std::generic_category(),
+        fmt::format("failed to create a private tmp in {}", base));
+  }
+  path_ = name;
+  strings_.push_back(fmt::format("TMPDIR={}", name));
+  for (auto &var : strings_) {
+    env_.push_back(var.data());
+  }
+  env_.push_back(nullptr);
+}
+
+PrivateTmp::~PrivateTmp() {
+  std::error_code ec;
+  fs::remove_all(path_, ec);
+}
+
+void Sandbox(const ParsedArgs &parsed, const AutomaticPaths *automatic,
+             const RulesetCache *rulesets) {
+  if (!landlock::Enabled()) {
+    return;
+  }
+  try {
+    ApplySandbox(parsed, automatic, nullptr, rulesets);
+  } catch (const std::exception &ex) {
+    throw std::runtime_error(
+        fmt::format("Failed to apply landlock ruleset: {}", ex.what()));
+  }
+}
+
+// The ruleset for SpawnExec, nullopt if landlock is not enabled.
+std::optional<landlock::Ruleset> BuildRuleset(const ParsedArgs &parsed,
+                                              const AutomaticPaths *automatic,
+                                              const RulesetCache *rulesets,
+                                              SandboxStats *stats) {
+  if (!landlock::Enabled()) {
+    return std::nullopt;
+  }
+  try {
+    return BuildSandbox(parsed, automatic, stats, rulesets);
+  } catch (const std::exception &ex) {
+    throw std::runtime_error(
+        fmt::format("Failed to apply landlock ruleset: {}", ex.what()));
+  }
+}
+
+// The caches to consult, in order.
+std::vector<std::unique_ptr<CacheBackend>>
+MakeCaches(const ParsedArgs &parsed, const RemoteCacheFactory &remote) {
+  std::vector<std::unique_ptr<CacheBackend>> caches;
+  if (!parsed.cache_dir.empty()) {
+    caches.push_back(std::make_unique<LocalCache>(parsed.cache_dir));
+  }
+  if (!parsed.remote_cache.empty()) {
+    if (!remote) {
+      throw std::runtime_error("--remote_cache is not supported by this "
+                               "wrapper, use remote_process_wrapper");
+    }
+    // Remote results are shared between machines, only programs kept off
+    // the network are hermetic enough for that.
+    if (parsed.deny_network && landlock::CanRestrictNetwork()) {
+      caches.push_back(remote(parsed));
+    }
+  }
+  return caches;
+}
+
+// Serves `action` from the first cache that has it, filling the caches
+// before it. Returns false on a miss.
+bool RestoreFromCaches(
+    const std::vector<std::unique_ptr<CacheBackend>> &caches,
+    const CacheAction &action) {
+  for (size_t i = 0; i < caches.size(); ++i) {
+    try {
+      if (!RestoreAction(caches[i].get(), action)) {
+        continue;
+      }
+    } catch (const std::exception &ex) {
+      fmt::println(stderr, "sandbox cache: failed to restore: {}", ex.what());
+      continue;
+    }
+    for (size_t j = 0; j < i; ++j) {
+      try {
+        StoreAction(caches[j].get(), action);
+      } catch (const std::exception &ex) {
+        fmt::println(stderr, "sandbox cache: failed to store: {}", ex.what());
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+std::string OutputArg(std::span<const std::string> args) {
+  for (size_t i = 1; i < args.size(); ++i) {
+    if (args[i] == "-o" && i + 1 < args.size()) {
+      return args[i + 1];
+    }
+    if (args[i].starts_with("-o") && args[i].size() > 2) {
+      return args[i].substr(2);
+    }
+  }
+  return "";
+}
+
+// Shows what the program wrote to `output`, see --capture_output.
+void ReportOutput(const ParsedArgs &parsed, const CapturedOutput &output,
+                  int code) {
+  size_t size = output.Size();
+  if (size == 0) {
+    return;
+  }
+  std::string name =
+      parsed.label.empty() ? parsed.remainder.front() : parsed.label;
+  if (auto out = OutputArg(parsed.remainder); !out.empty()) {
+    name = fmt::format("{} ({})", name, out);
+  }
+  if (code == 0) {
+    fmt::println(stderr, "{}: {} bytes of output", name, size);
+    return;
+  }
+  bool logged = false;
+  if (!parsed.output_log.empty()) {
+    try {
+      output.AppendCompressed(
+          parsed.output_log,
+          fmt::format("### {} failed with {}: {}\n", name, code,
+                      fmt::join(parsed.remainder, " ")));
+      logged = true;
+    } catch (const std::exception &ex) {
+      fmt::println(stderr, "sandbox output: {}", ex.what());
+    }
+  }
+  try {
+    size_t left = output.WriteHead(
+        STDERR_FILENO, logged ? kOutputLogHeadLines : SIZE_MAX);
+    if (left > 0) {
+      fmt::println(stderr, "{}: {} more lines in {}", name, left,
+                   parsed.output_log.native());
+    }
+  } catch (const std::exception &ex) {
+    fmt::println(stderr, "sandbox output: {}", ex.what());
+  }
+}
+
+} // namespace
+
+int Run(const ParsedArgs &parsed, const AutomaticPaths *automatic,
+        char **envp, const RemoteCacheFactory &remote,
+        const RulesetCache *rulesets) {
+  auto start = std::chrono::steady_clock::now();
+  auto start_time = std::chrono::system_clock::now();
+  std::vector<std::unique_ptr<CacheBackend>> caches;
+  std::optional<CacheAction> action;
+  // Resolved only once, for both the cache key and the spawn.
+  std::string program;
+  try {
+    // An audit has to see the compile run.
+    if (!parsed.audit) {
+      caches = MakeCaches(parsed, remote);
+    }
+    if (!caches.empty()) {
+      program = ResolveProgram(parsed.remainder.front(), envp);
+      if (!program.empty()) {
+        action = MakeCacheAction(parsed, program, envp);
+      }
+    }
+  } catch (const std::exception &ex) {
+    // Caching is an optimization, the program still runs.
+    fmt::println(stderr, "sandbox cache: {}", ex.what());
+  }
+  // A private tmp is removed and captured output shown after the program, so
+  // those have to run in a child.
+  if (!action && parsed.stats.empty() && !parsed.audit &&
+      !parsed.private_tmp && !parsed.capture_output) {
+    try {
+      Sandbox(parsed, automatic, rulesets);
+    } catch (const std::exception &ex) {
+      fmt::println(stderr, "{}", ex.what());
+      return 1;
+    }
+    return Exec(parsed.remainder, envp);
+  }
+
+  // Without a cache this is only reached for --stats, --audit, --private_tmp
+  // and --capture_output, which need the program to run in a child to see it
+  // finish.
+  ActionStats stats;
+  auto record = [&](int code) {
+    if (parsed.stats.empty()) {
+      return code;
+    }
+    stats.label = parsed.label;
+    stats.program = parsed.remainder.front();
+    stats.output = OutputArg(parsed.remainder);
+    stats.pid = getpid();
+    stats.start_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                         start_time.time_since_epoch())
+                         .count();
+    stats.wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    stats.exit_code = code;
+    try {
+      AppendStats(parsed.stats, stats);
+    } catch (const std::exception &ex) {
+      fmt::println(stderr, "sandbox stats: {}", ex.what());
+    }
+    return code;
+  };
+  stats.cache = action ? "miss" : "off";
+  if (action && RestoreFromCaches(caches, *action)) {
+    stats.cache = "hit";
+    return record(0);
+  }
+
+  if (program.empty()) {
+    program = ResolveProgram(parsed.remainder.front(), envp);
+  }
+  int code = 1;
+  // Declared first, so an interrupted program's private tmp is removed and
+  // its stats written before the wrapper dies of the signal.
+  ForwardSignals forward;
+  std::optional<PrivateTmp> tmp;
+  std::optional<CapturedOutput> output;
+  try {
+    const ParsedArgs *sandboxed = &parsed;
+    ParsedArgs with_tmp;
+    if (parsed.private_tmp) {
+      tmp.emplace(envp);
+      with_tmp = parsed;
+      with_tmp.rw_paths.push_back(tmp->Path());
+      sandboxed = &with_tmp;
+    }
+    if (parsed.capture_output) {
+      output.emplace(CapturedOutput::Create());
+    }
+    auto ruleset = parsed.audit
+                       ? std::optional<landlock::Ruleset>()
+                       : BuildRuleset(*sandboxed, automatic, rulesets,
+                                      &stats.sandbox);
+    code = SpawnExec(program, parsed.remainder, tmp ? tmp->Env() : envp,
+                     ruleset ? &*ruleset : nullptr, &stats.exec,
+                     &stats.sandbox, output ? output->Fd() : -1);
+    stats.exec.exec_latency_ns +=
+        stats.sandbox.create_ns + stats.sandbox.allow_ns;
+  } catch (const std::exception &ex) {
+    fmt::println(stderr, "{}", ex.what());
+    return 1;
+  }
+  if (output) {
+    ReportOutput(parsed, *output, code);
+  }
+  if (code == 0 && parsed.audit) {
+    try {
+      WriteAuditManifest(parsed);
+    } catch (const std::exception &ex) {
+      fmt::println(stderr, "sandbox audit: {}", ex.what());
+    }
+  }
+  if (code == 0 && action) {
+    for (auto &cache : caches) {
+      try {
+        StoreAction(cache.get(), *action);
+      } catch (const std::exception &ex) {
+        fmt::println(stderr, "sandbox cache: failed to store: {}", ex.what());
+      }
+    }
+  }
+  return record(code);
+}
+
+int WrapperMain(int argc, char **argv, const RemoteCacheFactory &remote) {
+  auto args = MakeArgs(argc, argv);
+  if (auto code = RunOnForkServer(args)) {
+    return *code;
+  }
+  auto parsed = ParseCommandLine(args);
+  if (!parsed.fork_server.empty()) {
+    return RunForkServer(parsed, remote);
+  }
+  return Run(parsed, nullptr, environ, remote);
+}
+
+} // namespace sandbox
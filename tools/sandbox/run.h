@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "sandbox/args.h"
+#include "sandbox/cache.h"
+#include "sandbox/sandbox.h"
+
+namespace sandbox {
+
+// Creates the backend for --remote_cache=<address> and the other
+// --remote_cache_* flags of `parsed`. The wrapper itself does not depend on
+// any RPC library, see src/service for an implementation.
+using RemoteCacheFactory =
+    std::function<std::unique_ptr<CacheBackend>(const ParsedArgs &parsed)>;
+
+// Runs the program in `parsed.remainder` in its sandbox with the environment
+// `envp`, the wrapper's job for a single program.
+//
+// Without a cache the calling process is replaced by the program and this
+// only returns if that failed. With --cache_dir or --remote_cache, hits are
+// restored without running anything, otherwise the program runs in a child
+// and its outputs are stored on success. The local cache is asked first, and
+// filled from remote hits. The remote cache is only used with --deny_network
+// on kernels that can enforce it. With --private_tmp the program runs in a
+// child too, with a new directory below the TMPDIR of `envp` as its TMPDIR,
+// which replaces /tmp in the sandbox and is removed when the program exits.
+// Returns the exit code for the wrapper.
+//
+// A fork server passes the automatic paths it opened and its `rulesets`.
+int Run(const ParsedArgs &parsed, const AutomaticPaths *automatic,
+        char **envp, const RemoteCacheFactory &remote = {},
+        const RulesetCache *rulesets = nullptr);
+
+// The main function of a process wrapper, `remote` is empty for wrappers
+// without remote cache support.
+int WrapperMain(int argc, char **argv, const RemoteCacheFactory &remote = {});
+
+} // namespace sandbox
@@ -0,0 +1,167 @@
+#include "sandbox/sandbox.h"
+
+#include <cerrno>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+#include <fmt/format.h>
+
+#include "sandbox/policy.h"
+
+namespace sandbox {
+namespace {
+
+// Basically all programs need to load glibc and other system libaries,
+// so make sure they are readable.
+const char *const kAutomaticReadonlyPaths[] = {
+    "/usr", "/bin", "/var", "/lib", "/lib32", "/lib64",
+};
+
+// Give some scratch space in tmp to all programs
+const char *const kAutomaticReadwritePaths[] = {
+    "/tmp",
+};
+
+} // namespace
+
+AutomaticPaths::~AutomaticPaths() {
+  for (const auto &[fd, access] : fds_) {
+    close(fd);
+  }
+}
+
+AutomaticPaths AutomaticPaths::Open() {
+  AutomaticPaths paths;
+  auto open_all = [&paths](std::span<const char *const> names,
+                           landlock::FSAccess access) {
+    for (const char *name : names) {
+      int fd = open(name, O_PATH | O_CLOEXEC);
+      if (fd < 0) {
+        if (errno == ENOENT) {
+          continue;
+        }
+        throw std::system_error(errno, std::generic_category(),
+                                fmt::format("failed to open path: {}", name));
+      }
+      paths.fds_.emplace_back(fd, access);
+    }
+  };
+  open_all(kAutomaticReadonlyPaths, landlock::FSAccess::Readonly());
+  paths.readonly_count_ = paths.fds_.size();
+  open_all(kAutomaticReadwritePaths, landlock::FSAccess::All());
+  return paths;
+}
+
+void AutomaticPaths::AllowAll(landlock::Ruleset *ruleset, bool tmp) const {
+  size_t count = tmp ? fds_.size() : readonly_count_;
+  for (size_t i = 0; i < count; ++i) {
+    ruleset->AllowFd(fds_[i].first, fds_[i].second);
+  }
+}
+
+std::vector<PolicyEntry> AutomaticEntries(bool tmp) {
+  std::vector<PolicyEntry> entries;
+  for (const char *p : kAutomaticReadonlyPaths) {
+    entries.push_back({.path = p, .access = landlock::FSAccess::kReadonly});
+  }
+  if (!tmp) {
+    return entries;
+  }
+  for (const char *p : kAutomaticReadwritePaths) {
+    entries.push_back({.path = p,
+                       .access = landlock::FSAccess::kAllDir |
+                                 landlock::FSAccess::kAllFile});
+  }
+  return entries;
+}
+
+landlock::Ruleset BuildSandbox(const ParsedArgs &parsed,
+                               const AutomaticPaths *automatic,
+                               SandboxStats *stats,
+                               const RulesetCache *rulesets) {
+  auto ns = [](auto duration) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+        .count();
+  };
+  auto start = std::chrono::steady_clock::now();
+  std::optional<Policy> policy;
+  if (!parsed.policy.empty()) {
+    policy.emplace(Policy::Map(parsed.policy));
+  }
+  std::string key;
+  if (parsed.private_tmp) {
+    rulesets = nullptr;
+  }
+  if (rulesets) {
+    key = RulesetCache::Key(parsed, policy ? &*policy : nullptr);
+    if (auto cached = rulesets->Find(key)) {
+      if (stats) {
+        stats->allow_ns = ns(std::chrono::steady_clock::now() - start);
+        stats->rules = cached->RuleCount();
+      }
+      return std::move(*cached);
+    }
+  }
+  auto create = std::chrono::steady_clock::now();
+  auto ruleset = landlock::Ruleset::Create(parsed.deny_network);
+  auto created = std::chrono::steady_clock::now();
+  if (automatic) {
+    automatic->AllowAll(&ruleset, !parsed.private_tmp);
+  } else {
+    for (const char *p : kAutomaticReadonlyPaths) {
+      ruleset.Allow(p, landlock::FSAccess::Readonly());
+    }
+    for (const char *p : kAutomaticReadwritePaths) {
+      if (!parsed.private_tmp) {
+        ruleset.Allow(p, landlock::FSAccess::All());
+      }
+    }
+  }
+  for (const auto &p : parsed.ro_dirs) {
+    ruleset.Allow(p, landlock::FSAccess::AllDir() &
+                         landlock::FSAccess::Readonly());
+  }
+  for (const auto &p : parsed.rw_dirs) {
+    ruleset.Allow(p, landlock::FSAccess::AllDir());
+  }
+  for (const auto &p : parsed.ro_paths) {
+    ruleset.Allow(p, landlock::FSAccess::Readonly());
+  }
+  for (const auto &p : parsed.rw_paths) {
+    ruleset.Allow(p, landlock::FSAccess::All());
+  }
+  if (policy) {
+    policy->AllowAll(&ruleset);
+  }
+  if (rulesets) {
+    rulesets->Offer(key, ruleset);
+  }
+  if (stats) {
+    stats->create_ns = ns(created - create);
+    stats->allow_ns =
+        ns(std::chrono::steady_clock::now() - start) - stats->create_ns;
+    stats->rules = ruleset.RuleCount();
+  }
+  return ruleset;
+}
+
+void ApplySandbox(const ParsedArgs &parsed, const AutomaticPaths *automatic,
+                  SandboxStats *stats, const RulesetCache *rulesets) {
+  auto ruleset = BuildSandbox(parsed, automatic, stats, rulesets);
+  auto built = std::chrono::steady_clock::now();
+  ruleset.Apply();
+  if (stats) {
+    stats->apply_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - built)
+                          .count();
+  }
+}
+
+} // namespace sandbox
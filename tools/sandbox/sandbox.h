@@ -0,0 +1,68 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "sandbox/args.h"
+#include "sandbox/landlock.h"
+#include "sandbox/policy.h"
+#include "sandbox/ruleset_cache.h"
+#include "sandbox/stats.h"
+
+namespace sandbox {
+
+// O_PATH descriptors for the system paths every sandboxed program is given.
+//
+// Opening them once lets a long lived process (see fork_server.h) skip the
+// path lookups for every program it starts.
+class AutomaticPaths {
+public:
+  AutomaticPaths(const AutomaticPaths &) = delete;
+  AutomaticPaths(AutomaticPaths &&other)
+      : fds_(std::move(other.fds_)), readonly_count_(other.readonly_count_) {}
+  AutomaticPaths &operator=(const AutomaticPaths &) = delete;
+  AutomaticPaths &operator=(AutomaticPaths &&) = delete;
+  ~AutomaticPaths();
+
+  // Opens all automatic paths that exist on this system.
+  static AutomaticPaths Open();
+
+  // Adds the paths to `ruleset`, without /tmp unless `tmp`.
+  void AllowAll(landlock::Ruleset *ruleset, bool tmp = true) const;
+
+private:
+  AutomaticPaths() = default;
+
+  // The readonly paths first, then the readwrite ones.
+  std::vector<std::pair<int, landlock::FSAccess>> fds_;
+  size_t readonly_count_ = 0;
+};
+
+// The automatic paths as policy rules, for leaving them out of policies
+// (see WritePolicy). Without `tmp` the readwrite ones are left out, which
+// --private_tmp doesn't grant.
+std::vector<PolicyEntry> AutomaticEntries(bool tmp = true);
+
+// Builds the ruleset for the automatic paths and the paths given in `parsed`,
+// without applying it. If `automatic` is null the automatic paths are opened
+// on the fly. With `rulesets`, a cached ruleset is returned if there is one,
+// and a new one is offered to the cache. Rulesets for --private_tmp are never
+// cached, their directory is new every time.
+//
+// Throws on failure. The time spent in each step is recorded in `stats` if
+// given.
+landlock::Ruleset BuildSandbox(const ParsedArgs &parsed,
+                               const AutomaticPaths *automatic = nullptr,
+                               SandboxStats *stats = nullptr,
+                               const RulesetCache *rulesets = nullptr);
+
+// Builds the ruleset like BuildSandbox and restricts the calling process to
+// it.
+//
+// Throws on failure, the process must not continue to the exec then.
+void ApplySandbox(const ParsedArgs &parsed,
+                  const AutomaticPaths *automatic = nullptr,
+                  SandboxStats *stats = nullptr,
+                  const RulesetCache *rulesets = nullptr);
+
+} // namespace sandbox
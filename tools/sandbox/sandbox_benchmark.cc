@@ -0,0 +1,131 @@
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include "sandbox/args.h"
+#include "sandbox/cache.h"
+#include "sandbox/landlock.h"
+#include "sandbox/policy.h"
+
+// Benchmarks of the work the wrapper does in process for every program, see
+// launcher_benchmark.cc for the end to end launch latency.
+
+namespace {
+
+namespace fs = std::filesystem;
+using sandbox::landlock::FSAccess;
+using sandbox::landlock::Ruleset;
+
+// `count` files spread over directories of 100, created once per count and
+// removed at exit.
+class ScratchFiles {
+public:
+  ~ScratchFiles() {
+    if (!dir_.empty()) {
+      fs::remove_all(dir_);
+    }
+  }
+
+  static const std::vector<fs::path> &Get(int count) {
+    static ScratchFiles scratch;
+    return scratch.Files(count);
+  }
+
+private:
+  const std::vector<fs::path> &Files(int count) {
+    auto [it, inserted] = files_.try_emplace(count);
+    if (!inserted) {
+      return it->second;
+    }
+    if (dir_.empty()) {
+      const char *tmpdir = getenv("TMPDIR");
+      std::string dir_template =
+          fs::path(tmpdir ? tmpdir : "/tmp") / "sandbox_benchmark.XXXXXX";
+      if (!mkdtemp(dir_template.data())) {
+        throw std::runtime_error("failed to create a scratch directory");
+      }
+      dir_ = dir_template;
+    }
+    for (int i = 0; i < count; ++i) {
+      auto subdir =
+          dir_ / fmt::format("files_{}", count) / fmt::format("d{}", i / 100);
+      if (i % 100 == 0) {
+        fs::create_directories(subdir);
+      }
+      auto file = subdir / fmt::format("f{}.h", i);
+      sandbox::WriteFileAtomic(file, "");
+      it->second.push_back(file);
+    }
+    return it->second;
+  }
+
+  fs::path dir_;
+  std::map<int, std::vector<fs::path>> files_;
+};
+
+void BM_ParseCommandLine(benchmark::State &state) {
+  // Long colon delimited lists, like the rules pass for the include
+  // directories of a target.
+  std::vector<std::string> args;
+  for (int i = 0; i < state.range(0); ++i) {
+    args.push_back(fmt::format(
+        "--ro_paths=/home/user/project/src/component_{0}/include:"
+        "/home/user/project/build/release/src/component_{0}/gen",
+        i));
+  }
+  args.insert(args.end(), {"--", "clang++", "-c", "main.cc", "-o", "main.o"});
+  for (auto _ : state) {
+    auto parsed = sandbox::ParseCommandLine(args);
+    benchmark::DoNotOptimize(parsed);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseCommandLine)->Arg(10)->Arg(1000)->Arg(10000);
+
+void BM_RulesetAllow(benchmark::State &state) {
+  if (!sandbox::landlock::Enabled()) {
+    state.SkipWithError("landlock is not enabled");
+    return;
+  }
+  const auto &files = ScratchFiles::Get(state.range(0));
+  for (auto _ : state) {
+    auto ruleset = Ruleset::Create();
+    for (const auto &file : files) {
+      ruleset.Allow(file, FSAccess::Readonly());
+    }
+    benchmark::DoNotOptimize(ruleset.RuleCount());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RulesetAllow)->Arg(10)->Arg(1000)->Arg(10000);
+
+// The same rules through a compiled policy, as the rules pass them.
+void BM_PolicyAllowAll(benchmark::State &state) {
+  if (!sandbox::landlock::Enabled()) {
+    state.SkipWithError("landlock is not enabled");
+    return;
+  }
+  const auto &files = ScratchFiles::Get(state.range(0));
+  std::vector<sandbox::PolicyEntry> entries;
+  for (const auto &file : files) {
+    entries.push_back({.path = file, .access = FSAccess::kReadonly});
+  }
+  auto path = files.front().parent_path().parent_path() / "rules.policy";
+  sandbox::WritePolicy(path, entries);
+  for (auto _ : state) {
+    auto ruleset = Ruleset::Create();
+    sandbox::Policy::Map(path).AllowAll(&ruleset);
+    benchmark::DoNotOptimize(ruleset.RuleCount());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PolicyAllowAll)->Arg(10)->Arg(1000)->Arg(10000);
+
+} // namespace
+
+BENCHMARK_MAIN();
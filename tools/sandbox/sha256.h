@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace sandbox {
+
+// A plain SHA-256, used for cache keys and content addresses.
+class Sha256 {
+public:
+  Sha256();
+
+  void Update(const void *data, size_t size);
+  void Update(std::string_view data) { Update(data.data(), data.size()); }
+
+  // Finishes the hash, the object must not be updated afterwards.
+  std::string HexDigest();
+
+private:
+  void Compress(const uint8_t *block);
+
+  std::array<uint32_t, 8> state_;
+  std::array<uint8_t, 64> buffer_;
+  size_t buffered_ = 0;
+  uint64_t length_ = 0;
+};
+
+} // namespace sandbox
@@ -0,0 +1,204 @@
+#include "sandbox/stats.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <fcntl.h>
+#include <map>
+#include <string_view>
+#include <system_error>
+#include <unistd.h>
+
+#include <absl/cleanup/cleanup.h>
+#include <absl/strings/ascii.h>
+#include <absl/strings/strip.h>
+#include <fmt/format.h>
+
+namespace sandbox {
+
+std::string JsonString(std::string_view value) {
+  std::string out = "\"";
+  for (char c : value) {
+    switch (c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out += fmt::format("\\u{:04x}", c);
+      } else {
+        out += c;
+      }
+    }
+  }
+  out += '"';
+  return out;
+}
+
+namespace {
+
+int64_t Micros(const timeval &tv) {
+  return int64_t{tv.tv_sec} * 1000000 + tv.tv_usec;
+}
+
+timeval Timeval(int64_t micros) {
+  return {.tv_sec = micros / 1000000, .tv_usec = micros % 1000000};
+}
+
+// Parses a JSON string starting at the opening quote, just enough for the
+// strings JsonString writes.
+std::optional<std::string> ParseString(std::string_view *in) {
+  if (!absl::ConsumePrefix(in, "\"")) {
+    return std::nullopt;
+  }
+  std::string out;
+  while (!in->empty()) {
+    char c = in->front();
+    in->remove_prefix(1);
+    if (c == '"') {
+      return out;
+    }
+    if (c != '\\') {
+      out += c;
+      continue;
+    }
+    if (in->empty()) {
+      return std::nullopt;
+    }
+    char escaped = in->front();
+    in->remove_prefix(1);
+    switch (escaped) {
+    case 'n':
+      out += '\n';
+      break;
+    case 'u': {
+      unsigned code = 0;
+      size_t digits = std::min<size_t>(4, in->size());
+      auto [end, ec] =
+          std::from_chars(in->data(), in->data() + digits, code, 16);
+      if (ec != std::errc() || end != in->data() + 4 || code > 0xff) {
+        return std::nullopt;
+      }
+      out += static_cast<char>(code);
+      in->remove_prefix(4);
+      break;
+    }
+    default:
+      out += escaped;
+    }
+  }
+  return std::nullopt;
+}
+
+// Parses a flat JSON object of strings and integers.
+bool ParseObject(std::string_view in,
+                 std::map<std::string, std::string, std::less<>> *strings,
+                 std::map<std::string, int64_t, std::less<>> *numbers) {
+  in = absl::StripAsciiWhitespace(in);
+  if (!absl::ConsumePrefix(&in, "{")) {
+    return false;
+  }
+  if (absl::ConsumePrefix(&in, "}")) {
+    return in.empty();
+  }
+  while (true) {
+    auto key = ParseString(&in);
+    if (!key || !absl::ConsumePrefix(&in, ":")) {
+      return false;
+    }
+    if (in.starts_with("\"")) {
+      auto value = ParseString(&in);
+      if (!value) {
+        return false;
+      }
+      (*strings)[*key] = std::move(*value);
+    } else {
+      int64_t value = 0;
+      auto [end, ec] = std::from_chars(in.data(), in.data() + in.size(), value);
+      if (ec != std::errc()) {
+        return false;
+      }
+      in.remove_prefix(end - in.data());
+      (*numbers)[*key] = value;
+    }
+    if (absl::ConsumePrefix(&in, "}")) {
+      return in.empty();
+    }
+    if (!absl::ConsumePrefix(&in, ",")) {
+      return false;
+    }
+  }
+}
+
+} // namespace
+
+void AppendStats(const std::filesystem::path &path, const ActionStats &stats) {
+  const auto &usage = stats.exec.usage;
+  auto line = fmt::format(
+      "{{\"label\":{},\"program\":{},\"output\":{},\"pid\":{},"
+      "\"start_us\":{},\"wall_ns\":{},\"cache\":{},\"create_ns\":{},"
+      "\"allow_ns\":{},\"apply_ns\":{},\"rules\":{},\"exec_latency_ns\":{},"
+      "\"exit_code\":{},\"max_rss_kb\":{},\"user_us\":{},\"sys_us\":{},"
+      "\"minflt\":{},\"majflt\":{}}}\n",
+      JsonString(stats.label), JsonString(stats.program),
+      JsonString(stats.output), stats.pid, stats.start_us, stats.wall_ns,
+      JsonString(stats.cache), stats.sandbox.create_ns, stats.sandbox.allow_ns,
+      stats.sandbox.apply_ns, stats.sandbox.rules, stats.exec.exec_latency_ns,
+      stats.exit_code, usage.ru_maxrss, Micros(usage.ru_utime),
+      Micros(usage.ru_stime), usage.ru_minflt, usage.ru_majflt);
+  int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(),
+                            fmt::format("failed to open {}", path.native()));
+  }
+  auto fd_cleanup = absl::MakeCleanup([fd] { close(fd); });
+  ssize_t written = write(fd, line.data(), line.size());
+  if (written != static_cast<ssize_t>(line.size())) {
+    throw std::system_error(errno, std::generic_category(),
+                            fmt::format("failed to write {}", path.native()));
+  }
+}
+
+std::optional<ActionStats> ParseStats(std::string_view line) {
+  std::map<std::string, std::string, std::less<>> strings;
+  std::map<std::string, int64_t, std::less<>> numbers;
+  if (!ParseObject(line, &strings, &numbers)) {
+    return std::nullopt;
+  }
+  auto string = [&strings](std::string_view key) {
+    auto it = strings.find(key);
+    return it == strings.end() ? std::string() : it->second;
+  };
+  auto number = [&numbers](std::string_view key) {
+    auto it = numbers.find(key);
+    return it == numbers.end() ? int64_t{0} : it->second;
+  };
+  ActionStats stats;
+  stats.label = string("label");
+  stats.program = string("program");
+  stats.output = string("output");
+  stats.pid = number("pid");
+  stats.start_us = number("start_us");
+  stats.wall_ns = number("wall_ns");
+  stats.cache = string("cache");
+  stats.sandbox.create_ns = number("create_ns");
+  stats.sandbox.allow_ns = number("allow_ns");
+  stats.sandbox.apply_ns = number("apply_ns");
+  stats.sandbox.rules = number("rules");
+  stats.exec.exec_latency_ns = number("exec_latency_ns");
+  stats.exec.usage.ru_maxrss = number("max_rss_kb");
+  stats.exec.usage.ru_utime = Timeval(number("user_us"));
+  stats.exec.usage.ru_stime = Timeval(number("sys_us"));
+  stats.exec.usage.ru_minflt = number("minflt");
+  stats.exec.usage.ru_majflt = number("majflt");
+  stats.exit_code = number("exit_code");
+  return stats;
+}
+
+} // namespace sandbox
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <sys/resource.h>
+
+namespace sandbox {
+
+// Time spent building (BuildSandbox) and applying the sandbox.
+struct SandboxStats {
+  int64_t create_ns = 0;
+  int64_t allow_ns = 0;
+  int64_t apply_ns = 0;
+  int32_t rules = 0;
+};
+
+// What the parent learns about a child started by SpawnExec.
+struct ExecStats {
+  // From the start of the sandbox setup until the program is exec'd.
+  int64_t exec_latency_ns = 0;
+  rusage usage{};
+};
+
+// A record of one wrapped program, see --stats.
+struct ActionStats {
+  // See --label.
+  std::string label;
+  std::string program;
+  // The -o argument of the program, if any, to tell compiles apart.
+  std::string output;
+  // The wrapper process.
+  int pid = 0;
+  // Microseconds since the epoch when the wrapper started the action.
+  int64_t start_us = 0;
+  int64_t wall_ns = 0;
+  // "hit", "miss" or "off", see --cache_dir.
+  std::string cache;
+  // Zero on cache hits, nothing was run then.
+  SandboxStats sandbox;
+  ExecStats exec;
+  int exit_code = 0;
+};
+
+// Appends `stats` as a single JSON line to `path`. A single write with
+// O_APPEND, so concurrent wrappers can share a file.
+//
+// Throws on failure.
+void AppendStats(const std::filesystem::path &path, const ActionStats &stats);
+
+// Quotes and escapes `value` for JSON.
+std::string JsonString(std::string_view value);
+
+// Parses a line written by AppendStats, nullopt if it is malformed. Unknown
+// keys are ignored.
+std::optional<ActionStats> ParseStats(std::string_view line);
+
+} // namespace sandbox
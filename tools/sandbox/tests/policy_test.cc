@@ -0,0 +1,140 @@
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "sandbox/landlock.h"
+#include "sandbox/policy.h"
+
+namespace sandbox {
+namespace {
+
+namespace fs = std::filesystem;
+
+class PolicyTest : public testing::Test {
+protected:
+  void SetUp() override {
+    const char *tmp = std::getenv("TMPDIR");
+    dir_ = fs::path(tmp ? tmp : "/tmp") /
+           testing::UnitTest::GetInstance()->current_test_info()->name();
+    fs::remove_all(dir_);
+    fs::create_directories(dir_ / "include");
+    std::ofstream(dir_ / "main.cc") << "int main() {}\n";
+    dir_ = fs::canonical(dir_);
+  }
+  void TearDown() override { fs::remove_all(dir_); }
+
+  // A valid policy with a file and a directory rule.
+  fs::path Write() {
+    auto policy = dir_ / "test.policy";
+    PolicyEntry entries[] = {
+        {.path = dir_ / "main.cc", .access = landlock::FSAccess::kReadonly},
+        {.path = dir_ / "include", .access = landlock::FSAccess::kAllDir},
+    };
+    WritePolicy(policy, entries);
+    return policy;
+  }
+
+  std::string Read(const fs::path &path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), {}};
+  }
+
+  fs::path WriteBytes(std::string_view bytes) {
+    auto path = dir_ / "corrupt.policy";
+    std::ofstream(path, std::ios::binary | std::ios::trunc)
+        .write(bytes.data(), bytes.size());
+    return path;
+  }
+
+  fs::path dir_;
+};
+
+TEST_F(PolicyTest, RoundTrip) {
+  auto policy = Policy::Map(Write());
+  ASSERT_EQ(policy.Rules().size(), 2);
+  // Rules are sorted by path.
+  const auto &dir = policy.Rules()[0];
+  EXPECT_EQ(policy.Path(dir), (dir_ / "include").native());
+  EXPECT_EQ(dir.type, PolicyRule::DIRECTORY);
+  EXPECT_EQ(dir.access, landlock::FSAccess::kAllDir);
+  const auto &file = policy.Rules()[1];
+  EXPECT_EQ(policy.Path(file), (dir_ / "main.cc").native());
+  EXPECT_EQ(file.type, PolicyRule::FILE);
+  // Files never get directory rights.
+  EXPECT_EQ(file.access,
+            landlock::FSAccess::kReadonly & landlock::FSAccess::kAllFile);
+  EXPECT_EQ(policy.GraphHash().size(), 64);
+}
+
+TEST_F(PolicyTest, GraphHashOnlyChangesWithTheRules) {
+  auto first = std::string(Policy::Map(Write()).GraphHash());
+  EXPECT_EQ(Policy::Map(Write()).GraphHash(), first);
+  PolicyEntry entries[] = {
+      {.path = dir_ / "main.cc", .access = landlock::FSAccess::kReadonly},
+  };
+  WritePolicy(dir_ / "other.policy", entries);
+  EXPECT_NE(Policy::Map(dir_ / "other.policy").GraphHash(), first);
+}
+
+TEST_F(PolicyTest, RejectsTruncatedFiles) {
+  auto bytes = Read(Write());
+  for (size_t size : {size_t{0}, sizeof(PolicyHeader) - 1,
+                      sizeof(PolicyHeader), sizeof(PolicyHeader) + 1,
+                      bytes.size() - 1}) {
+    EXPECT_THROW(Policy::Map(WriteBytes(bytes.substr(0, size))),
+                 std::runtime_error)
+        << size << " bytes";
+  }
+  EXPECT_THROW(Policy::Map(WriteBytes(bytes + "x")), std::runtime_error);
+}
+
+TEST_F(PolicyTest, RejectsCorruptFiles) {
+  auto bytes = Read(Write());
+  PolicyHeader header;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  auto with_header = [&](const PolicyHeader &changed) {
+    auto corrupt = bytes;
+    std::memcpy(corrupt.data(), &changed, sizeof(changed));
+    return corrupt;
+  };
+
+  auto bad_magic = header;
+  bad_magic.magic[0] ^= 1;
+  EXPECT_THROW(Policy::Map(WriteBytes(with_header(bad_magic))),
+               std::runtime_error);
+  auto bad_version = header;
+  ++bad_version.version;
+  EXPECT_THROW(Policy::Map(WriteBytes(with_header(bad_version))),
+               std::runtime_error);
+  auto bad_count = header;
+  ++bad_count.rule_count;
+  EXPECT_THROW(Policy::Map(WriteBytes(with_header(bad_count))),
+               std::runtime_error);
+
+  auto unterminated = bytes;
+  unterminated.back() = 'x';
+  EXPECT_THROW(Policy::Map(WriteBytes(unterminated)), std::runtime_error);
+
+  auto out_of_bounds = bytes;
+  PolicyRule rule;
+  std::memcpy(&rule, bytes.data() + sizeof(PolicyHeader), sizeof(rule));
+  rule.path_offset = header.strings_size;
+  std::memcpy(out_of_bounds.data() + sizeof(PolicyHeader), &rule,
+              sizeof(rule));
+  EXPECT_THROW(Policy::Map(WriteBytes(out_of_bounds)), std::runtime_error);
+}
+
+TEST_F(PolicyTest, MissingFileThrows) {
+  EXPECT_THROW(Policy::Map(dir_ / "missing.policy"), std::runtime_error);
+}
+
+} // namespace
+} // namespace sandbox
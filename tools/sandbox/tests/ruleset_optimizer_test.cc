@@ -0,0 +1,130 @@
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "sandbox/landlock.h"
+#include "sandbox/policy.h"
+#include "sandbox/ruleset_optimizer.h"
+
+namespace sandbox {
+namespace {
+
+namespace fs = std::filesystem;
+using landlock::FSAccess;
+
+constexpr uint64_t kRead = FSAccess::READ_FILE;
+constexpr uint64_t kReadonly = FSAccess::kReadonly;
+
+// The rules as "<path> <access>" strings, for readable failures.
+std::vector<std::string> Describe(const std::vector<PolicyEntry> &rules) {
+  std::vector<std::string> described;
+  for (const auto &rule : rules) {
+    described.push_back(rule.path.native() + " " +
+                        std::to_string(rule.access.Value()));
+  }
+  return described;
+}
+
+std::string Rule(const fs::path &path, uint64_t access) {
+  return path.native() + " " + std::to_string(access);
+}
+
+// The paths below are made up, so they are only normalized.
+const fs::path kRoot = "/nonexistent/optimizer";
+
+TEST(OptimizeRulesTest, DropsChildrenOfADirectoryWithTheSameAccess) {
+  PolicyEntry entries[] = {
+      {.path = kRoot / "include/a.h", .access = kRead},
+      {.path = kRoot / "include", .access = kReadonly},
+      {.path = kRoot / "include/sub/b.h", .access = kReadonly},
+  };
+  EXPECT_EQ(Describe(OptimizeRules(entries)),
+            std::vector{Rule(kRoot / "include", kReadonly)});
+}
+
+TEST(OptimizeRulesTest, KeepsChildrenWithMoreAccess) {
+  constexpr uint64_t kWrite = kRead | FSAccess::WRITE_FILE;
+  PolicyEntry entries[] = {
+      {.path = kRoot, .access = kReadonly},
+      {.path = kRoot / "out.o", .access = kWrite},
+  };
+  EXPECT_EQ(Describe(OptimizeRules(entries)),
+            (std::vector{Rule(kRoot, kReadonly),
+                         Rule(kRoot / "out.o", kWrite)}));
+}
+
+TEST(OptimizeRulesTest, DropsRulesCoveredByImpliedRules) {
+  PolicyEntry entries[] = {
+      {.path = "/nonexistent/usr/include/stdio.h", .access = kRead},
+      {.path = kRoot / "a.h", .access = kRead},
+  };
+  PolicyEntry implied[] = {
+      {.path = "/nonexistent/usr", .access = kReadonly},
+  };
+  EXPECT_EQ(Describe(OptimizeRules(entries, implied)),
+            std::vector{Rule(kRoot / "a.h", kRead)});
+}
+
+TEST(OptimizeRulesTest, ImpliedRulesAreNotEmitted) {
+  PolicyEntry implied[] = {
+      {.path = kRoot, .access = kReadonly},
+  };
+  EXPECT_TRUE(OptimizeRules({}, implied).empty());
+}
+
+TEST(OptimizeRulesTest, MergesDuplicates) {
+  PolicyEntry entries[] = {
+      {.path = kRoot / "a.h", .access = kRead},
+      {.path = kRoot / "a.h", .access = FSAccess::EXECUTE},
+  };
+  EXPECT_EQ(Describe(OptimizeRules(entries)),
+            std::vector{Rule(kRoot / "a.h", kRead | FSAccess::EXECUTE)});
+}
+
+TEST(OptimizeRulesTest, SiblingWithACommonPrefixIsNotBeneath) {
+  PolicyEntry entries[] = {
+      {.path = kRoot / "a/b", .access = kReadonly},
+      {.path = kRoot / "a/bc", .access = kReadonly},
+      {.path = kRoot / "a/b/c", .access = kReadonly},
+  };
+  EXPECT_EQ(Describe(OptimizeRules(entries)),
+            (std::vector{Rule(kRoot / "a/b", kReadonly),
+                         Rule(kRoot / "a/bc", kReadonly)}));
+}
+
+TEST(OptimizeRulesTest, NormalizesPaths) {
+  PolicyEntry entries[] = {
+      {.path = "/nonexistent/optimizer/./x/../include/", .access = kReadonly},
+      {.path = "/nonexistent/optimizer//include/a.h", .access = kReadonly},
+  };
+  auto optimized = OptimizeRules(entries);
+  ASSERT_EQ(optimized.size(), 1);
+  EXPECT_EQ(optimized[0].path.lexically_normal(),
+            (kRoot / "include/").lexically_normal());
+}
+
+TEST(OptimizeRulesTest, SymlinksKeepTheirTarget) {
+  const char *tmp = std::getenv("TMPDIR");
+  auto dir = fs::path(tmp ? tmp : "/tmp") / "ruleset_optimizer_test";
+  fs::remove_all(dir);
+  fs::create_directories(dir / "include");
+  fs::create_directories(dir / "elsewhere");
+  fs::create_directory_symlink(dir / "elsewhere", dir / "include/link");
+  dir = fs::canonical(dir);
+
+  PolicyEntry entries[] = {
+      {.path = dir / "include", .access = kReadonly},
+      {.path = dir / "include/link", .access = kReadonly},
+  };
+  EXPECT_EQ(Describe(OptimizeRules(entries)),
+            (std::vector{Rule(dir / "elsewhere", kReadonly),
+                         Rule(dir / "include", kReadonly)}));
+  fs::remove_all(dir);
+}
+
+} // namespace
+} // namespace sandbox
@@ -0,0 +1,66 @@
+#include <string>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include "sandbox/sha256.h"
+
+namespace sandbox {
+namespace {
+
+std::string Hash(std::string_view data) {
+  Sha256 hash;
+  hash.Update(data);
+  return hash.HexDigest();
+}
+
+// FIPS 180-2 examples, plus lengths around the 56 byte padding boundary and
+// the 64 byte block.
+TEST(Sha256Test, KnownVectors) {
+  const std::pair<std::string, std::string> vectors[] = {
+      {"",
+       "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+      {"abc",
+       "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+      {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+       "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+      {"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmn"
+       "opjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+       "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"},
+      {std::string(55, 'a'),
+       "9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318"},
+      {std::string(56, 'a'),
+       "b35439a4ac6f0948b6d6f9e3c6af0f5f590ce20f1bde7090ef7970686ec6738a"},
+      {std::string(63, 'a'),
+       "7d3e74a05d7db15bce4ad9ec0658ea98e3f06eeecf16b4c6fff2da457ddc2f34"},
+      {std::string(64, 'a'),
+       "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb"},
+      {std::string(65, 'a'),
+       "635361c48bb9eab14198e76ea8ab7f1a41685d6ad62aa9146d301d4f17eb0ae0"},
+      {std::string(1000000, 'a'),
+       "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+  };
+  for (const auto &[data, digest] : vectors) {
+    EXPECT_EQ(Hash(data), digest) << data.size() << " bytes";
+  }
+}
+
+// Updates of every size straddle the block boundaries differently, the
+// digest must be the same as for a single update.
+TEST(Sha256Test, SplitUpdates) {
+  std::string data;
+  for (int i = 0; i < 1000; ++i) {
+    data.push_back(static_cast<char>(i * 7));
+  }
+  auto expected = Hash(data);
+  for (size_t step = 1; step <= 130; ++step) {
+    Sha256 hash;
+    for (size_t i = 0; i < data.size(); i += step) {
+      hash.Update(std::string_view(data).substr(i, step));
+    }
+    EXPECT_EQ(hash.HexDigest(), expected) << "step " << step;
+  }
+}
+
+} // namespace
+} // namespace sandbox
@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include "sandbox/stats.h"
+
+namespace {
+
+using sandbox::ActionStats;
+using sandbox::JsonString;
+
+constexpr std::string_view kUsage =
+    "Turns the --stats of process_wrapper into a Chrome trace, usage:\n"
+    "./trace_export <stats.jsonl> <trace.json>\n\n"
+    "Every label (the target of an action) gets its own process track, with\n"
+    "overlapping actions on separate threads. A \"build\" track counts the\n"
+    "actions running at any time. Open the output in chrome://tracing or\n"
+    "https://ui.perfetto.dev.";
+
+int64_t EndUs(const ActionStats &stats) {
+  return stats.start_us + stats.wall_ns / 1000;
+}
+
+// A track per label, actions that overlap go on separate lanes.
+struct Track {
+  int pid;
+  std::vector<int64_t> lane_ends;
+
+  int Lane(const ActionStats &stats) {
+    for (size_t i = 0; i < lane_ends.size(); ++i) {
+      if (lane_ends[i] <= stats.start_us) {
+        lane_ends[i] = EndUs(stats);
+        return i + 1;
+      }
+    }
+    lane_ends.push_back(EndUs(stats));
+    return lane_ends.size();
+  }
+};
+
+std::string Name(const ActionStats &stats) {
+  if (!stats.output.empty()) {
+    return std::filesystem::path(stats.output).filename();
+  }
+  return std::filesystem::path(stats.program).filename();
+}
+
+std::string Args(const ActionStats &stats) {
+  return fmt::format(
+      "{{\"program\":{},\"output\":{},\"cache\":{},\"exit_code\":{},"
+      "\"rules\":{},\"create_us\":{},\"allow_us\":{},\"apply_us\":{},"
+      "\"max_rss_kb\":{},\"user_ms\":{},\"sys_ms\":{},\"minflt\":{},"
+      "\"majflt\":{}}}",
+      JsonString(stats.program), JsonString(stats.output),
+      JsonString(stats.cache), stats.exit_code, stats.sandbox.rules,
+      stats.sandbox.create_ns / 1000, stats.sandbox.allow_ns / 1000,
+      stats.sandbox.apply_ns / 1000, stats.exec.usage.ru_maxrss,
+      stats.exec.usage.ru_utime.tv_sec * 1000 +
+          stats.exec.usage.ru_utime.tv_usec / 1000,
+      stats.exec.usage.ru_stime.tv_sec * 1000 +
+          stats.exec.usage.ru_stime.tv_usec / 1000,
+      stats.exec.usage.ru_minflt, stats.exec.usage.ru_majflt);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fmt::println(stderr, "{}", kUsage);
+    return 1;
+  }
+  std::ifstream input(argv[1]);
+  if (!input) {
+    fmt::println(stderr, "failed to open {}", argv[1]);
+    return 1;
+  }
+  std::vector<ActionStats> actions;
+  std::string line;
+  for (int lineno = 1; std::getline(input, line); ++lineno) {
+    if (line.empty()) {
+      continue;
+    }
+    auto stats = sandbox::ParseStats(line);
+    if (!stats) {
+      // A wrapper that was killed mid-write, don't lose the whole build.
+      fmt::println(stderr, "{}:{}: skipping malformed line", argv[1], lineno);
+      continue;
+    }
+    actions.push_back(std::move(*stats));
+  }
+  std::sort(actions.begin(), actions.end(),
+            [](const ActionStats &a, const ActionStats &b) {
+              return a.start_us < b.start_us;
+            });
+
+  std::vector<std::string> events;
+  std::map<std::string, Track> tracks;
+  int64_t origin = actions.empty() ? 0 : actions.front().start_us;
+  events.push_back("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,"
+                   "\"args\":{\"name\":\"build\"}}");
+  for (const auto &stats : actions) {
+    auto label = stats.label.empty() ? "(unlabeled)" : stats.label;
+    auto [it, inserted] =
+        tracks.try_emplace(label, Track{.pid = int(tracks.size()) + 1});
+    auto &track = it->second;
+    if (inserted) {
+      events.push_back(fmt::format(
+          "{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":{},"
+          "\"args\":{{\"name\":{}}}}}",
+          track.pid, JsonString(label)));
+      events.push_back(fmt::format(
+          "{{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":{},"
+          "\"args\":{{\"sort_index\":{}}}}}",
+          track.pid, track.pid));
+    }
+    int tid = track.Lane(stats);
+    int64_t ts = stats.start_us - origin;
+    events.push_back(fmt::format(
+        "{{\"name\":{},\"cat\":{},\"ph\":\"X\",\"pid\":{},\"tid\":{},"
+        "\"ts\":{},\"dur\":{},\"args\":{}}}",
+        JsonString(Name(stats)),
+        JsonString(std::filesystem::path(stats.program).filename().native()),
+        track.pid, tid, ts, stats.wall_ns / 1000, Args(stats)));
+    if (stats.exec.exec_latency_ns > 0) {
+      events.push_back(fmt::format(
+          "{{\"name\":\"sandbox setup\",\"cat\":\"sandbox\",\"ph\":\"X\","
+          "\"pid\":{},\"tid\":{},\"ts\":{},\"dur\":{}}}",
+          track.pid, tid, ts, stats.exec.exec_latency_ns / 1000));
+    }
+  }
+
+  // Idle cores show up as dips in the number of running actions.
+  std::vector<std::pair<int64_t, int>> changes;
+  for (const auto &stats : actions) {
+    changes.emplace_back(stats.start_us, 1);
+    changes.emplace_back(EndUs(stats), -1);
+  }
+  std::sort(changes.begin(), changes.end());
+  int running = 0;
+  for (size_t i = 0; i < changes.size(); ++i) {
+    running += changes[i].second;
+    if (i + 1 < changes.size() && changes[i + 1].first == changes[i].first) {
+      continue;
+    }
+    events.push_back(fmt::format(
+        "{{\"name\":\"running actions\",\"ph\":\"C\",\"pid\":0,\"ts\":{},"
+        "\"args\":{{\"actions\":{}}}}}",
+        changes[i].first - origin, running));
+  }
+
+  std::ofstream output(argv[2], std::ios::trunc);
+  output << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+         << fmt::format("{}", fmt::join(events, ",\n")) << "\n]}\n";
+  if (!output.flush()) {
+    fmt::println(stderr, "failed to write {}", argv[2]);
+    return 1;
+  }
+  return 0;
+}